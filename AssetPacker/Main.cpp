@@ -0,0 +1,44 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "AssetReader.h"
+
+//Packs loose files into one archive that VulcanTest mounts at startup (assets.pak next to the executable by default).
+//Each file is stored under the name it is looked up by, which is its path as given unless name=path is used.
+//
+//	AssetPacker <output.pak> <file|name=file>...
+
+int main(int argc, char* argv[]) {
+	if (argc < 3) {
+		std::cerr << "usage: AssetPacker <output.pak> <file|name=file>..." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<std::pair<std::string, std::string>> files;
+	for (int i = 2; i < argc; i++) {
+		std::string argument = argv[i];
+		size_t separator = argument.find('=');
+		if (separator == std::string::npos) {
+			files.push_back({ argument, argument });
+		}
+		else {
+			files.push_back({ argument.substr(0, separator), argument.substr(separator + 1) });
+		}
+	}
+
+	try {
+		AssetArchive::Pack(argv[1], files);
+
+		AssetArchive archive;
+		archive.Open(argv[1]);
+		std::cout << argv[1] << ": " << archive.GetEntryCount() << " assets" << std::endl;
+	}
+	catch (const std::exception & e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
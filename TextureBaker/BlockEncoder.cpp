@@ -0,0 +1,283 @@
+#include "BlockEncoder.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+
+static uint16_t PackRgb565(const int* rgb)
+{
+	int r = (std::min(std::max(rgb[0], 0), 255) * 31 + 127) / 255;
+	int g = (std::min(std::max(rgb[1], 0), 255) * 63 + 127) / 255;
+	int b = (std::min(std::max(rgb[2], 0), 255) * 31 + 127) / 255;
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+//Matches the expansion the decoder and the hardware perform, so the index search sees the colours that will be sampled.
+static void UnpackRgb565(uint16_t color, int* rgb)
+{
+	int r = (color >> 11) & 0x1f;
+	int g = (color >> 5) & 0x3f;
+	int b = color & 0x1f;
+	rgb[0] = (r << 3) | (r >> 2);
+	rgb[1] = (g << 2) | (g >> 4);
+	rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void EncodeColorBlock(const uint8_t* texels, uint8_t* block)
+{
+	int minColor[3] = { 255, 255, 255 };
+	int maxColor[3] = { 0, 0, 0 };
+	int mean[3] = { 0, 0, 0 };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			minColor[c] = std::min(minColor[c], static_cast<int>(texels[i * 4 + c]));
+			maxColor[c] = std::max(maxColor[c], static_cast<int>(texels[i * 4 + c]));
+			mean[c] += texels[i * 4 + c];
+		}
+	}
+	for (int c = 0; c < 3; c++)
+	{
+		mean[c] = (mean[c] + 8) / 16;
+	}
+
+	//The bounding box only gives the extent per channel; the sign of the covariance with green picks which diagonal
+	//the colours actually run along.
+	int covarianceRg = 0;
+	int covarianceGb = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int g = texels[i * 4 + 1] - mean[1];
+		covarianceRg += (texels[i * 4 + 0] - mean[0]) * g;
+		covarianceGb += (texels[i * 4 + 2] - mean[2]) * g;
+	}
+	if (covarianceRg < 0)
+	{
+		std::swap(minColor[0], maxColor[0]);
+	}
+	if (covarianceGb < 0)
+	{
+		std::swap(minColor[2], maxColor[2]);
+	}
+
+	//Inset the endpoints slightly; the outermost texels are then still reached by the interpolated entries.
+	for (int c = 0; c < 3; c++)
+	{
+		int inset = (maxColor[c] - minColor[c]) / 16;
+		minColor[c] += inset;
+		maxColor[c] -= inset;
+	}
+
+	uint16_t color0 = PackRgb565(maxColor);
+	uint16_t color1 = PackRgb565(minColor);
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	block[0] = static_cast<uint8_t>(color0);
+	block[1] = static_cast<uint8_t>(color0 >> 8);
+	block[2] = static_cast<uint8_t>(color1);
+	block[3] = static_cast<uint8_t>(color1 >> 8);
+
+	//Equal endpoints would select the three colour mode; every texel then uses index 0.
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		UnpackRgb565(color0, palette[0]);
+		UnpackRgb565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestError = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int error = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int difference = texels[i * 4 + c] - palette[p][c];
+					error += difference * difference;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices |= static_cast<uint32_t>(bestIndex) << (2 * i);
+		}
+	}
+
+	block[4] = static_cast<uint8_t>(indices);
+	block[5] = static_cast<uint8_t>(indices >> 8);
+	block[6] = static_cast<uint8_t>(indices >> 16);
+	block[7] = static_cast<uint8_t>(indices >> 24);
+}
+
+static void EncodeAlphaBlock(const uint8_t* texels, uint8_t* block)
+{
+	int minAlpha = 255;
+	int maxAlpha = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		minAlpha = std::min(minAlpha, static_cast<int>(texels[i * 4 + 3]));
+		maxAlpha = std::max(maxAlpha, static_cast<int>(texels[i * 4 + 3]));
+	}
+
+	block[0] = static_cast<uint8_t>(maxAlpha);
+	block[1] = static_cast<uint8_t>(minAlpha);
+
+	uint64_t indices = 0;
+	if (maxAlpha != minAlpha)
+	{
+		int palette[8];
+		palette[0] = maxAlpha;
+		palette[1] = minAlpha;
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * maxAlpha + i * minAlpha) / 7;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int bestIndex = 0;
+			int bestError = INT32_MAX;
+			for (int p = 0; p < 8; p++)
+			{
+				int error = std::abs(texels[i * 4 + 3] - palette[p]);
+				if (error < bestError)
+				{
+					bestError = error;
+					bestIndex = p;
+				}
+			}
+			indices |= static_cast<uint64_t>(bestIndex) << (3 * i);
+		}
+	}
+
+	for (int i = 0; i < 6; i++)
+	{
+		block[2 + i] = static_cast<uint8_t>(indices >> (8 * i));
+	}
+}
+
+void BlockEncoder::EncodeBc1(const uint8_t* texels, uint8_t* block)
+{
+	EncodeColorBlock(texels, block);
+}
+
+void BlockEncoder::EncodeBc3(const uint8_t* texels, uint8_t* block)
+{
+	EncodeAlphaBlock(texels, block);
+	EncodeColorBlock(texels, block + 8);
+}
+
+bool BlockEncoder::HasTranslucentTexels(const TextureData& texture)
+{
+	const MipLevel& level = texture.Levels[0];
+	for (VkDeviceSize i = 0; i < level.Width * static_cast<VkDeviceSize>(level.Height); i++)
+	{
+		if (texture.Data[static_cast<size_t>(level.Offset + i * 4 + 3)] != 255)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+TextureData BlockEncoder::Encode(const TextureData& texture, VkFormat format, uint32_t threadCount)
+{
+	if (texture.Format != VK_FORMAT_R8G8B8A8_UNORM && texture.Format != VK_FORMAT_R8G8B8A8_SRGB) {
+		throw std::runtime_error("block encoder expects an RGBA8 texture!");
+	}
+
+	bool srgb = texture.Format == VK_FORMAT_R8G8B8A8_SRGB;
+	bool bc3 = format == VK_FORMAT_BC3_UNORM_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+	if (!bc3 && format != VK_FORMAT_BC1_RGB_UNORM_BLOCK && format != VK_FORMAT_BC1_RGB_SRGB_BLOCK) {
+		throw std::runtime_error("block encoder only writes BC1 and BC3!");
+	}
+
+	TextureData encoded;
+	encoded.Format = bc3 ? (srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK) : (srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+	encoded.Width = texture.Width;
+	encoded.Height = texture.Height;
+	TextureLoader::AllocateLevels(encoded, static_cast<uint32_t>(texture.Levels.size()));
+
+	//One job per row of blocks over the whole chain; rows are small enough that a shared counter balances the load
+	//even though level 0 holds three quarters of the work.
+	struct RowJob
+	{
+		uint32_t Level;
+		uint32_t BlockY;
+	};
+	std::vector<RowJob> jobs;
+	for (uint32_t level = 0; level < texture.Levels.size(); level++)
+	{
+		for (uint32_t blockY = 0; blockY < (texture.Levels[level].Height + 3) / 4; blockY++)
+		{
+			jobs.push_back({ level, blockY });
+		}
+	}
+
+	uint32_t blockBytes = bc3 ? 16 : 8;
+	std::atomic<size_t> nextJob(0);
+
+	auto worker = [&]() {
+		uint8_t texels[64];
+		for (size_t job = nextJob++; job < jobs.size(); job = nextJob++)
+		{
+			const MipLevel& source = texture.Levels[jobs[job].Level];
+			const MipLevel& destination = encoded.Levels[jobs[job].Level];
+			uint32_t blockY = jobs[job].BlockY;
+			uint32_t blocksWide = (source.Width + 3) / 4;
+
+			for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+			{
+				//Edge blocks repeat the last row and column so the padding does not pull the endpoints away.
+				for (uint32_t y = 0; y < 4; y++)
+				{
+					uint32_t sourceY = std::min(blockY * 4 + y, source.Height - 1);
+					for (uint32_t x = 0; x < 4; x++)
+					{
+						uint32_t sourceX = std::min(blockX * 4 + x, source.Width - 1);
+						memcpy(texels + (y * 4 + x) * 4, texture.Data.data() + source.Offset + (static_cast<size_t>(sourceY) * source.Width + sourceX) * 4, 4);
+					}
+				}
+
+				uint8_t* block = encoded.Data.data() + destination.Offset + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes;
+				if (bc3)
+				{
+					EncodeBc3(texels, block);
+				}
+				else
+				{
+					EncodeBc1(texels, block);
+				}
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (uint32_t i = 1; i < std::max(threadCount, 1u); i++)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	return encoded;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include "TextureLoader.h"
+
+//Compresses RGBA8 mip chains to BC1 or BC3 with a bounding box endpoint fit. Quality sits between the fastest realtime
+//encoders and an exhaustive search, which is plenty for an offline bake that runs once per asset.
+class BlockEncoder
+{
+public:
+	//Encodes every level of an R8G8B8A8 texture, splitting rows of blocks across threadCount threads.
+	//BC1 is opaque only; use BC3 for textures with alpha. The sRGB-ness of the source format carries over.
+	static TextureData Encode(const TextureData& texture, VkFormat format, uint32_t threadCount);
+
+	static void EncodeBc1(const uint8_t* texels, uint8_t* block);
+	static void EncodeBc3(const uint8_t* texels, uint8_t* block);
+
+	static bool HasTranslucentTexels(const TextureData& texture);
+};
@@ -0,0 +1,174 @@
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include "MipmapGenerator.h"
+#include "TextureLoader.h"
+#include "BlockEncoder.h"
+
+//Bakes a JPEG/PNG/TGA/BMP into a KTX2 file that VulcanTest uploads without decoding: alpha premultiplied, full mip chain,
+//and BC1/BC3 compressed unless rgba8 is asked for.
+//
+//	TextureBaker <input> <output.ktx2> [--format auto|bc1|bc3|rgba8] [--srgb] [--straight-alpha] [--no-mips] [--threads N]
+
+struct BakeOptions {
+	std::string inputPath;
+	std::string outputPath;
+	std::string format = "auto";
+	bool srgb = false;
+	bool premultiply = true;
+	bool generateMips = true;
+	uint32_t threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+};
+
+void printUsage() {
+	std::cerr << "usage: TextureBaker <input> <output.ktx2> [--format auto|bc1|bc3|rgba8] [--srgb] [--straight-alpha] [--no-mips] [--threads N]" << std::endl;
+}
+
+BakeOptions parseOptions(int argc, char* argv[]) {
+	BakeOptions options;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--format" && i + 1 < argc) {
+			options.format = argv[++i];
+		}
+		else if (argument == "--threads" && i + 1 < argc) {
+			options.threadCount = std::max(static_cast<uint32_t>(std::atoi(argv[++i])), 1u);
+		}
+		else if (argument == "--srgb") {
+			options.srgb = true;
+		}
+		else if (argument == "--straight-alpha") {
+			options.premultiply = false;
+		}
+		else if (argument == "--no-mips") {
+			options.generateMips = false;
+		}
+		else if (argument.rfind("--", 0) == 0) {
+			throw std::runtime_error("unknown option " + argument);
+		}
+		else {
+			positional.push_back(argument);
+		}
+	}
+
+	if (positional.size() != 2) {
+		printUsage();
+		throw std::runtime_error("expected an input and an output path");
+	}
+	if (options.format != "auto" && options.format != "bc1" && options.format != "bc3" && options.format != "rgba8") {
+		throw std::runtime_error("unknown format " + options.format);
+	}
+
+	options.inputPath = positional[0];
+	options.outputPath = positional[1];
+	return options;
+}
+
+//Premultiplying before filtering keeps the colour of fully transparent texels from bleeding into the smaller levels.
+void premultiplyAlpha(uint8_t* pixels, size_t pixelCount) {
+	for (size_t i = 0; i < pixelCount; i++) {
+		uint32_t alpha = pixels[i * 4 + 3];
+		for (int c = 0; c < 3; c++) {
+			pixels[i * 4 + c] = static_cast<uint8_t>((pixels[i * 4 + c] * alpha + 127) / 255);
+		}
+	}
+}
+
+//Root mean square error of level 0 after a round trip through the CPU decoder.
+double measureError(const TextureData& source, const TextureData& encoded) {
+	TextureData decoded = TextureLoader::Decompress(encoded);
+	const MipLevel& level = source.Levels[0];
+
+	double sum = 0.0;
+	size_t count = static_cast<size_t>(level.Width) * level.Height * 4;
+	for (size_t i = 0; i < count; i++) {
+		double difference = static_cast<double>(source.Data[static_cast<size_t>(level.Offset) + i]) - decoded.Data[static_cast<size_t>(decoded.Levels[0].Offset) + i];
+		sum += difference * difference;
+	}
+	return std::sqrt(sum / count);
+}
+
+void bake(const BakeOptions& options) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	int texWidth, texHeight, texChannels;
+	stbi_uc* pixels = stbi_load(options.inputPath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+	if (!pixels) {
+		throw std::runtime_error("failed to load " + options.inputPath + ": " + stbi_failure_reason());
+	}
+
+	uint32_t width = static_cast<uint32_t>(texWidth);
+	uint32_t height = static_cast<uint32_t>(texHeight);
+	if (options.premultiply) {
+		premultiplyAlpha(pixels, static_cast<size_t>(width) * height);
+	}
+
+	TextureData texture;
+	texture.Format = options.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	texture.Width = width;
+	texture.Height = height;
+	texture.Premultiplied = options.premultiply;
+
+	uint32_t mipLevels = options.generateMips ? MipmapGenerator::GetMipLevelCount(width, height) : 1;
+	texture.Levels = MipmapGenerator::GenerateLevels(pixels, width, height, mipLevels, texture.Data);
+	stbi_image_free(pixels);
+
+	auto decoded = std::chrono::high_resolution_clock::now();
+
+	std::string format = options.format;
+	if (format == "auto") {
+		format = BlockEncoder::HasTranslucentTexels(texture) ? "bc3" : "bc1";
+	}
+
+	TextureData output;
+	if (format == "rgba8") {
+		output = texture;
+	}
+	else {
+		VkFormat blockFormat = format == "bc1" ? VK_FORMAT_BC1_RGB_UNORM_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+		output = BlockEncoder::Encode(texture, blockFormat, options.threadCount);
+		output.Premultiplied = texture.Premultiplied;
+	}
+
+	auto encoded = std::chrono::high_resolution_clock::now();
+
+	TextureLoader::SaveKtx2(options.outputPath, output);
+
+	auto milliseconds = [](std::chrono::high_resolution_clock::time_point from, std::chrono::high_resolution_clock::time_point to) {
+		return std::chrono::duration<double, std::milli>(to - from).count();
+	};
+
+	std::cout << options.inputPath << " -> " << options.outputPath << std::endl;
+	std::cout << "  " << width << "x" << height << ", " << output.Levels.size() << " mip levels, " << TextureLoader::GetFormatName(output.Format)
+		<< (output.Premultiplied ? ", premultiplied alpha" : ", straight alpha") << std::endl;
+	std::cout << "  " << output.Data.size() << " bytes (" << texture.Data.size() << " as RGBA8)" << std::endl;
+	if (output.IsCompressed()) {
+		std::cout << "  RMSE " << measureError(texture, output) << " on level 0" << std::endl;
+	}
+	std::cout << "  decode + mips " << milliseconds(start, decoded) << " ms, encode " << milliseconds(decoded, encoded) << " ms on "
+		<< (output.IsCompressed() ? options.threadCount : 1) << " threads" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		bake(parseOptions(argc, argv));
+	}
+	catch (const std::exception & e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,252 @@
+#include "AssetReader.h"
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static const char ArchiveMagic[4] = { 'V', 'T', 'P', 'K' };
+static const uint32_t ArchiveVersion = 1;
+static const size_t ArchiveHeaderSize = 16;
+static const size_t ArchiveNameSize = AssetArchive::MaxNameLength + 1;
+static const size_t ArchiveEntrySize = ArchiveNameSize + 16;
+static const uint64_t ArchiveAlignment = 16;
+
+MappedFile::MappedFile(const std::string& path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+	FileHandle = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		throw std::runtime_error("failed to get the size of " + path + "!");
+	}
+	Size = static_cast<size_t>(size.QuadPart);
+
+	//Empty files cannot be mapped; they simply have no data.
+	if (Size > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			CloseHandle(file);
+			throw std::runtime_error("failed to map " + path + "!");
+		}
+		MappingHandle = mapping;
+
+		Data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (Data == nullptr) {
+			CloseHandle(mapping);
+			CloseHandle(file);
+			throw std::runtime_error("failed to map " + path + "!");
+		}
+	}
+#else
+	int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		throw std::runtime_error("failed to open " + path + "!");
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0) {
+		close(file);
+		throw std::runtime_error("failed to get the size of " + path + "!");
+	}
+	Size = static_cast<size_t>(status.st_size);
+
+	if (Size > 0)
+	{
+		void* data = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED) {
+			close(file);
+			throw std::runtime_error("failed to map " + path + "!");
+		}
+		Data = static_cast<const uint8_t*>(data);
+	}
+
+	//The mapping holds its own reference to the file.
+	close(file);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+	if (Data != nullptr)
+	{
+		UnmapViewOfFile(Data);
+	}
+	if (MappingHandle != nullptr)
+	{
+		CloseHandle(static_cast<HANDLE>(MappingHandle));
+	}
+	if (FileHandle != nullptr)
+	{
+		CloseHandle(static_cast<HANDLE>(FileHandle));
+	}
+#else
+	if (Data != nullptr)
+	{
+		munmap(const_cast<uint8_t*>(Data), Size);
+	}
+#endif
+}
+
+template <typename T>
+static T ReadArchiveValue(const MappedFile& file, size_t offset)
+{
+	if (offset + sizeof(T) > file.GetSize()) {
+		throw std::runtime_error("asset archive is truncated!");
+	}
+
+	T value;
+	memcpy(&value, file.GetData() + offset, sizeof(T));
+	return value;
+}
+
+void AssetArchive::Open(const std::string& path)
+{
+	File = std::make_shared<const MappedFile>(path);
+	Entries.clear();
+
+	if (File->GetSize() < ArchiveHeaderSize || memcmp(File->GetData(), ArchiveMagic, sizeof(ArchiveMagic)) != 0) {
+		throw std::runtime_error("not an asset archive: " + path);
+	}
+	if (ReadArchiveValue<uint32_t>(*File, 4) != ArchiveVersion) {
+		throw std::runtime_error("unsupported asset archive version: " + path);
+	}
+
+	uint32_t entryCount = ReadArchiveValue<uint32_t>(*File, 8);
+	for (uint32_t i = 0; i < entryCount; i++)
+	{
+		size_t entryOffset = ArchiveHeaderSize + i * ArchiveEntrySize;
+		if (entryOffset + ArchiveEntrySize > File->GetSize()) {
+			throw std::runtime_error("asset archive is truncated!");
+		}
+
+		const char* name = reinterpret_cast<const char*>(File->GetData() + entryOffset);
+		Entry entry;
+		entry.Offset = ReadArchiveValue<uint64_t>(*File, entryOffset + ArchiveNameSize);
+		entry.Size = ReadArchiveValue<uint64_t>(*File, entryOffset + ArchiveNameSize + 8);
+		if (entry.Offset + entry.Size > File->GetSize()) {
+			throw std::runtime_error("asset archive is truncated!");
+		}
+
+		Entries[std::string(name, strnlen(name, ArchiveNameSize))] = entry;
+	}
+}
+
+bool AssetArchive::Find(const std::string& name, AssetView& view) const
+{
+	auto entry = Entries.find(name);
+	if (entry == Entries.end())
+	{
+		return false;
+	}
+
+	view.Data = File->GetData() + entry->second.Offset;
+	view.Size = static_cast<size_t>(entry->second.Size);
+	view.Owner = File;
+	return true;
+}
+
+void AssetArchive::Pack(const std::string& path, const std::vector<std::pair<std::string, std::string>>& files)
+{
+	std::vector<uint8_t> table(ArchiveHeaderSize + files.size() * ArchiveEntrySize);
+	uint32_t entryCount = static_cast<uint32_t>(files.size());
+	memcpy(table.data(), ArchiveMagic, sizeof(ArchiveMagic));
+	memcpy(table.data() + 4, &ArchiveVersion, sizeof(ArchiveVersion));
+	memcpy(table.data() + 8, &entryCount, sizeof(entryCount));
+
+	//Inputs are mapped one at a time and written straight from the mapping.
+	std::ofstream out(path, std::ios::binary);
+	if (!out.is_open()) {
+		throw std::runtime_error("failed to create asset archive " + path + "!");
+	}
+	out.write(reinterpret_cast<const char*>(table.data()), table.size());
+
+	uint64_t offset = table.size();
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		const std::string& name = files[i].first;
+		if (name.empty() || name.size() > MaxNameLength) {
+			throw std::runtime_error("asset name must be 1 to 63 characters: " + name);
+		}
+
+		uint64_t alignedOffset = (offset + ArchiveAlignment - 1) / ArchiveAlignment * ArchiveAlignment;
+		static const char padding[ArchiveAlignment] = {};
+		out.write(padding, static_cast<std::streamsize>(alignedOffset - offset));
+		offset = alignedOffset;
+
+		MappedFile file(files[i].second);
+		out.write(reinterpret_cast<const char*>(file.GetData()), static_cast<std::streamsize>(file.GetSize()));
+
+		uint64_t size = file.GetSize();
+		uint8_t* entry = table.data() + ArchiveHeaderSize + i * ArchiveEntrySize;
+		memcpy(entry, name.data(), name.size());
+		memcpy(entry + ArchiveNameSize, &offset, sizeof(offset));
+		memcpy(entry + ArchiveNameSize + 8, &size, sizeof(size));
+		offset += size;
+	}
+
+	out.seekp(0);
+	out.write(reinterpret_cast<const char*>(table.data()), table.size());
+	if (!out) {
+		throw std::runtime_error("failed to write asset archive " + path + "!");
+	}
+}
+
+void AssetReader::Mount(const std::string& archivePath)
+{
+	AssetArchive archive;
+	archive.Open(archivePath);
+	Archives.insert(Archives.begin(), std::move(archive));
+}
+
+AssetView AssetReader::Read(const std::string& name) const
+{
+	AssetView view;
+	for (const auto& archive : Archives)
+	{
+		if (archive.Find(name, view))
+		{
+			return view;
+		}
+	}
+	return Map(name);
+}
+
+bool AssetReader::Exists(const std::string& name) const
+{
+	AssetView view;
+	for (const auto& archive : Archives)
+	{
+		if (archive.Find(name, view))
+		{
+			return true;
+		}
+	}
+	return std::ifstream(name).good();
+}
+
+AssetView AssetReader::Map(const std::string& path)
+{
+	AssetView view;
+	view.Owner = std::make_shared<const MappedFile>(path);
+	view.Data = view.Owner->GetData();
+	view.Size = view.Owner->GetSize();
+	return view;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+
+//A whole file mapped read-only into the address space. Pages come straight from the OS file cache the first time they
+//are touched, so nothing is copied into the process and parts of the file that are never read never become resident.
+class MappedFile
+{
+private:
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+};
+
+//The bytes of one asset, pointing into a mapping that Owner keeps alive. Copying a view never copies the data.
+struct AssetView
+{
+	const uint8_t* Data = nullptr;
+	size_t Size = 0;
+	std::shared_ptr<const MappedFile> Owner;
+};
+
+//Many assets in one file: a 16 byte header ("VTPK", version, entry count), a table of fixed size entries (name, offset,
+//size) and the data, every entry starting on a 16 byte boundary so SPIR-V and texture levels can be used in place.
+class AssetArchive
+{
+private:
+	struct Entry
+	{
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	std::shared_ptr<const MappedFile> File;
+	std::unordered_map<std::string, Entry> Entries;
+
+public:
+	static constexpr uint32_t MaxNameLength = 63;
+
+	void Open(const std::string& path);
+	bool Find(const std::string& name, AssetView& view) const;
+	size_t GetEntryCount() const { return Entries.size(); }
+
+	//Writes an archive holding each file (second) under its asset name (first).
+	static void Pack(const std::string& path, const std::vector<std::pair<std::string, std::string>>& files);
+};
+
+//Resolves asset names against the mounted archives, most recently mounted first, then against the file system.
+//Read() and Exists() may be called from any thread once mounting is done.
+class AssetReader
+{
+private:
+	std::vector<AssetArchive> Archives;
+
+public:
+	void Mount(const std::string& archivePath);
+	size_t GetMountedCount() const { return Archives.size(); }
+
+	AssetView Read(const std::string& name) const;
+	bool Exists(const std::string& name) const;
+
+	//Maps a loose file, bypassing the archives.
+	static AssetView Map(const std::string& path);
+};
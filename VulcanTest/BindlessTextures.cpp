@@ -0,0 +1,182 @@
+#include "BindlessTextures.h"
+#include <algorithm>
+#include <stdexcept>
+
+BindlessTextures::BindlessTextures()
+{
+}
+
+BindlessTextures::~BindlessTextures()
+{
+}
+
+void BindlessTextures::Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t requestedCapacity)
+{
+	Device = device;
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties = {};
+	indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+	VkPhysicalDeviceProperties2 properties = {};
+	properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties.pNext = &indexingProperties;
+	vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+	//A combined image sampler counts against both the sampler and the sampled image limits.
+	Capacity = std::min({ requestedCapacity,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers, indexingProperties.maxDescriptorSetUpdateAfterBindSamplers });
+
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = Binding;
+	binding.descriptorCount = Capacity;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	//Partially bound: empty and removed slots may hold stale descriptors as long as no shader indexes them.
+	VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+		VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+	bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	bindingFlagsInfo.bindingCount = 1;
+	bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &bindingFlagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	if (vkCreateDescriptorSetLayout(Device, &layoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create bindless descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = Capacity;
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = 1;
+
+	if (vkCreateDescriptorPool(Device, &poolInfo, nullptr, &DescriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create bindless descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = DescriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &DescriptorSetLayout;
+
+	if (vkAllocateDescriptorSets(Device, &allocInfo, &DescriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate bindless descriptor set!");
+	}
+
+	//Hand out low slots first.
+	FreeSlots.resize(Capacity);
+	for (uint32_t i = 0; i < Capacity; i++)
+	{
+		FreeSlots[i] = Capacity - 1 - i;
+	}
+	PendingSlots.clear();
+}
+
+void BindlessTextures::Destroy()
+{
+	vkDestroyDescriptorPool(Device, DescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(Device, DescriptorSetLayout, nullptr);
+	DescriptorPool = VK_NULL_HANDLE;
+	DescriptorSetLayout = VK_NULL_HANDLE;
+	DescriptorSet = VK_NULL_HANDLE;
+	FreeSlots.clear();
+	PendingSlots.clear();
+}
+
+uint32_t BindlessTextures::Add(VkImageView imageView, VkSampler sampler)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	if (FreeSlots.empty()) {
+		throw std::runtime_error("out of bindless texture slots!");
+	}
+
+	uint32_t slot = FreeSlots.back();
+	FreeSlots.pop_back();
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = imageView;
+	imageInfo.sampler = sampler;
+
+	VkWriteDescriptorSet descriptorWrite = {};
+	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptorWrite.dstSet = DescriptorSet;
+	descriptorWrite.dstBinding = Binding;
+	descriptorWrite.dstArrayElement = slot;
+	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(Device, 1, &descriptorWrite, 0, nullptr);
+
+	return slot;
+}
+
+void BindlessTextures::Remove(uint32_t slot, uint64_t lastFrame)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	PendingSlots.push_back({ slot, lastFrame });
+}
+
+void BindlessTextures::Collect(uint64_t completedFrameCount)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	auto completed = std::stable_partition(PendingSlots.begin(), PendingSlots.end(),
+		[completedFrameCount](const PendingSlot& pending) { return pending.LastFrame > completedFrameCount; });
+	for (auto it = completed; it != PendingSlots.end(); ++it)
+	{
+		FreeSlots.push_back(it->Slot);
+	}
+	PendingSlots.erase(completed, PendingSlots.end());
+}
+
+uint32_t BindlessTextures::GetUsedCount()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	return Capacity - static_cast<uint32_t>(FreeSlots.size());
+}
+
+bool BindlessTextures::IsSupported(VkPhysicalDevice physicalDevice)
+{
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &indexingFeatures;
+	vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+
+	return indexingFeatures.shaderSampledImageArrayNonUniformIndexing && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+		indexingFeatures.descriptorBindingUpdateUnusedWhilePending && indexingFeatures.descriptorBindingPartiallyBound && indexingFeatures.runtimeDescriptorArray;
+}
+
+VkPhysicalDeviceDescriptorIndexingFeaturesEXT BindlessTextures::GetRequiredFeatures()
+{
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+	return indexingFeatures;
+}
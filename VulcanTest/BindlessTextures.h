@@ -0,0 +1,54 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <mutex>
+
+//One descriptor set holding a large UPDATE_AFTER_BIND array of combined image samplers (VK_EXT_descriptor_indexing).
+//The set is bound once per command buffer and shaders pick a texture with a nonuniform index, so any number of materials
+//draw without rebinding. Slots come from a free-list; a removed slot is only reused once the frames that might still
+//sample it have completed.
+class BindlessTextures
+{
+private:
+	struct PendingSlot
+	{
+		uint32_t Slot;
+		uint64_t LastFrame;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout DescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+
+	uint32_t Capacity = 0;
+	std::vector<uint32_t> FreeSlots;
+	std::vector<PendingSlot> PendingSlots;
+	std::mutex Mutex;
+
+public:
+	static constexpr uint32_t Binding = 0;
+
+	BindlessTextures();
+	~BindlessTextures();
+
+	//Capacity is clamped to the device's update-after-bind sampled image limits.
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t requestedCapacity);
+	void Destroy();
+
+	//Both are safe to call while the set is bound in command buffers that are still pending.
+	uint32_t Add(VkImageView imageView, VkSampler sampler);
+	//lastFrame is the last submission that may sample the slot; it returns to the free-list in Collect().
+	void Remove(uint32_t slot, uint64_t lastFrame);
+	void Collect(uint64_t completedFrameCount);
+
+	VkDescriptorSetLayout GetLayout() { return DescriptorSetLayout; }
+	VkDescriptorSet GetDescriptorSet() { return DescriptorSet; }
+	uint32_t GetCapacity() { return Capacity; }
+	uint32_t GetUsedCount();
+
+	//Checks the descriptor indexing features this class needs, for device selection.
+	static bool IsSupported(VkPhysicalDevice physicalDevice);
+	//Fills the feature struct to chain into VkDeviceCreateInfo::pNext.
+	static VkPhysicalDeviceDescriptorIndexingFeaturesEXT GetRequiredFeatures();
+};
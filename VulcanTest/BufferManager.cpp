@@ -2,55 +2,7 @@
 #include "BufferManager.h"
 #include <stdexcept>
 
-uint32_t BufferManager::findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-			return i;
-		}
-	}
-
-	throw std::runtime_error("failed to find suitable memory type!");
-}
-
-VkCommandBuffer BufferManager::StartCommandBuffer(VkDevice Device, VkCommandPool CommandPool)
-{
-	VkCommandBufferAllocateInfo AllocationInfo = {};
-	AllocationInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	AllocationInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	AllocationInfo.commandPool = CommandPool;
-	AllocationInfo.commandBufferCount = 1;
-
-	VkCommandBuffer CommandBuffer;
-	vkAllocateCommandBuffers(Device, &AllocationInfo, &CommandBuffer);
-
-	VkCommandBufferBeginInfo BeginInfo = {};
-	BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	vkBeginCommandBuffer(CommandBuffer, &BeginInfo);
-
-	return CommandBuffer;
-}
-
-void BufferManager::EndCommandBuffer(VkDevice Device, VkQueue GraphicsQueue, VkCommandPool CommandPool, VkCommandBuffer CommandBuffer)
-{
-	vkEndCommandBuffer(CommandBuffer);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &CommandBuffer;
-
-	vkQueueSubmit(GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(GraphicsQueue);
-
-	vkFreeCommandBuffers(Device, CommandPool, 1, &CommandBuffer);
-}
-
-void BufferManager::CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+void BufferManager::CreateBuffer(MemoryAllocator& allocator, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory)
 {
 	VkBufferCreateInfo bufferInfo = {};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -62,28 +14,15 @@ void BufferManager::CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice devic
 		throw std::runtime_error("failed to create buffer!");
 	}
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate buffer memory!");
-	}
-
-	vkBindBufferMemory(device, buffer, bufferMemory, 0);
+	bufferMemory = allocator.AllocateBufferMemory(buffer, properties);
 }
 
-void BufferManager::CopyBuffer(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkPhysicalDevice physicalDevice, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+void BufferManager::CopyBuffer(UploadContext& uploadContext, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset)
 {
-	VkCommandBuffer commandBuffer = StartCommandBuffer(device, commandPool);
+	VkCommandBuffer commandBuffer = uploadContext.GetCommandBuffer();
 
 	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = srcOffset;
 	copyRegion.size = size;
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	EndCommandBuffer(device, graphicsQueue, commandPool, commandBuffer);
 }
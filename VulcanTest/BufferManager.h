@@ -1,12 +1,10 @@
 #include <vulkan\vulkan_core.h>
+#include "MemoryAllocator.h"
+#include "UploadContext.h"
 
 static class BufferManager
 {
-private:
-	static uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 public:
-	static VkCommandBuffer StartCommandBuffer(VkDevice Device, VkCommandPool CommandPool);
-	static void EndCommandBuffer(VkDevice Device, VkQueue GraphicsQueue, VkCommandPool CommandPool, VkCommandBuffer CommandBuffer);
-	static void CreateBuffer(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-	static void CopyBuffer(VkDevice device, VkCommandPool commandPool, VkQueue graphicsQueue, VkPhysicalDevice physicalDevice, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	static void CreateBuffer(MemoryAllocator& allocator, VkDevice device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory);
+	static void CopyBuffer(UploadContext& uploadContext, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0);
 };
@@ -0,0 +1,206 @@
+#include "CommandRecorder.h"
+#include "Profiler.h"
+#include <stdexcept>
+#include <algorithm>
+
+CommandRecorder::CommandRecorder()
+{
+}
+
+CommandRecorder::~CommandRecorder()
+{
+}
+
+void CommandRecorder::Create(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, uint32_t threadCount)
+{
+	Device = device;
+	Quit = false;
+	JobGeneration = 0;
+
+	Slots.resize(std::max<uint32_t>(threadCount, 1));
+	for (auto& slot : Slots)
+	{
+		slot.Frames.resize(frameCount);
+		for (auto& frame : slot.Frames)
+		{
+			VkCommandPoolCreateInfo poolInfo = {};
+			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+			if (vkCreateCommandPool(Device, &poolInfo, nullptr, &frame.CommandPool) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create recording command pool!");
+			}
+
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = frame.CommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(Device, &allocInfo, &frame.CommandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate secondary command buffer!");
+			}
+		}
+	}
+
+	for (uint32_t i = 1; i < Slots.size(); i++)
+	{
+		Slots[i].Thread = std::thread(&CommandRecorder::WorkerLoop, this, i);
+	}
+}
+
+void CommandRecorder::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(JobMutex);
+		Quit = true;
+	}
+	JobReady.notify_all();
+
+	for (auto& slot : Slots)
+	{
+		if (slot.Thread.joinable())
+		{
+			slot.Thread.join();
+		}
+
+		for (auto& frame : slot.Frames)
+		{
+			vkDestroyCommandPool(Device, frame.CommandPool, nullptr);
+		}
+	}
+
+	Slots.clear();
+	RecordedBuffers.clear();
+}
+
+const std::vector<VkCommandBuffer>& CommandRecorder::Record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const RecordFunction& record)
+{
+	uint32_t sliceCount = GetSliceCount(itemCount);
+
+	{
+		std::lock_guard<std::mutex> lock(JobMutex);
+		JobFrame = frame;
+		JobItemCount = itemCount;
+		JobSliceCount = sliceCount;
+		JobInheritance = &inheritance;
+		JobRecord = &record;
+		JobError = nullptr;
+		PendingSlots = sliceCount > 1 ? sliceCount - 1 : 0;
+		JobGeneration++;
+	}
+	JobReady.notify_all();
+
+	std::exception_ptr error;
+	if (sliceCount > 0)
+	{
+		try
+		{
+			RecordSlice(0);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(JobMutex);
+		JobDone.wait(lock, [this] { return PendingSlots == 0; });
+		if (!error)
+		{
+			error = JobError;
+		}
+	}
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+
+	RecordedBuffers.clear();
+	for (uint32_t i = 0; i < sliceCount; i++)
+	{
+		RecordedBuffers.push_back(Slots[i].Frames[frame].CommandBuffer);
+	}
+
+	return RecordedBuffers;
+}
+
+void CommandRecorder::WorkerLoop(uint32_t slotIndex)
+{
+	PROFILE_THREAD("command recording " + std::to_string(slotIndex));
+	uint64_t seenGeneration = 0;
+
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(JobMutex);
+		JobReady.wait(lock, [this, seenGeneration] { return Quit || JobGeneration != seenGeneration; });
+		if (Quit)
+		{
+			return;
+		}
+
+		seenGeneration = JobGeneration;
+		if (slotIndex >= JobSliceCount)
+		{
+			continue;
+		}
+		lock.unlock();
+
+		std::exception_ptr error;
+		try
+		{
+			RecordSlice(slotIndex);
+		}
+		catch (...)
+		{
+			error = std::current_exception();
+		}
+
+		lock.lock();
+		if (error && !JobError)
+		{
+			JobError = error;
+		}
+		if (--PendingSlots == 0)
+		{
+			JobDone.notify_one();
+		}
+	}
+}
+
+void CommandRecorder::RecordSlice(uint32_t slotIndex)
+{
+	PROFILE_FUNCTION();
+	SlotFrame& frame = Slots[slotIndex].Frames[JobFrame];
+
+	uint32_t firstItem = GetSliceFirstItem(JobItemCount, JobSliceCount, slotIndex);
+	uint32_t endItem = GetSliceFirstItem(JobItemCount, JobSliceCount, slotIndex + 1);
+
+	if (vkResetCommandPool(Device, frame.CommandPool, 0) != VK_SUCCESS) {
+		throw std::runtime_error("failed to reset recording command pool!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = JobInheritance;
+
+	if (vkBeginCommandBuffer(frame.CommandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("failed to begin recording secondary command buffer!");
+	}
+
+	(*JobRecord)(frame.CommandBuffer, firstItem, endItem - firstItem);
+
+	if (vkEndCommandBuffer(frame.CommandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record secondary command buffer!");
+	}
+}
+
+//Slices are contiguous and balanced to within one item so the secondaries execute in draw list order.
+uint32_t CommandRecorder::GetSliceFirstItem(uint32_t itemCount, uint32_t sliceCount, uint32_t slice)
+{
+	return static_cast<uint32_t>(static_cast<uint64_t>(itemCount) * slice / sliceCount);
+}
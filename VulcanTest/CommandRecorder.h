@@ -0,0 +1,68 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+//Records a draw list into secondary command buffers on several threads at once.
+//Every recording slot owns a VkCommandPool per frame in flight, so slots never share a pool and a frame's pools
+//can be reset wholesale once that frame's fence has signalled. Slot 0 is recorded on the calling thread.
+class CommandRecorder
+{
+public:
+	typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t firstItem, uint32_t itemCount)> RecordFunction;
+
+private:
+	struct SlotFrame
+	{
+		VkCommandPool CommandPool = VK_NULL_HANDLE;
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+	};
+
+	struct RecordingSlot
+	{
+		std::thread Thread;
+		std::vector<SlotFrame> Frames;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	std::vector<RecordingSlot> Slots;
+	std::vector<VkCommandBuffer> RecordedBuffers;
+
+	std::mutex JobMutex;
+	std::condition_variable JobReady;
+	std::condition_variable JobDone;
+	uint64_t JobGeneration = 0;
+	uint32_t PendingSlots = 0;
+	bool Quit = false;
+
+	uint32_t JobFrame = 0;
+	uint32_t JobItemCount = 0;
+	uint32_t JobSliceCount = 0;
+	const VkCommandBufferInheritanceInfo* JobInheritance = nullptr;
+	const RecordFunction* JobRecord = nullptr;
+	std::exception_ptr JobError;
+
+	void WorkerLoop(uint32_t slotIndex);
+	void RecordSlice(uint32_t slotIndex);
+
+public:
+	CommandRecorder();
+	~CommandRecorder();
+
+	void Create(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, uint32_t threadCount);
+	void Destroy();
+
+	//The previous submission of this frame's buffers must have completed; their pools are reset before recording.
+	//Returns the secondary buffers to hand to vkCmdExecuteCommands, in draw list order.
+	const std::vector<VkCommandBuffer>& Record(uint32_t frame, const VkCommandBufferInheritanceInfo& inheritance, uint32_t itemCount, const RecordFunction& record);
+
+	uint32_t GetThreadCount() { return static_cast<uint32_t>(Slots.size()); }
+	//Number of secondaries Record() splits itemCount items into.
+	uint32_t GetSliceCount(uint32_t itemCount) const { return static_cast<uint32_t>(Slots.size()) < itemCount ? static_cast<uint32_t>(Slots.size()) : itemCount; }
+	//First item of a slice, so callers can tell which secondary a RecordFunction call is filling.
+	static uint32_t GetSliceFirstItem(uint32_t itemCount, uint32_t sliceCount, uint32_t slice);
+};
@@ -0,0 +1,248 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+bool DescriptorBinding::operator==(const DescriptorBinding& other) const
+{
+	return Binding == other.Binding && Type == other.Type &&
+		BufferInfo.buffer == other.BufferInfo.buffer && BufferInfo.offset == other.BufferInfo.offset && BufferInfo.range == other.BufferInfo.range &&
+		ImageInfo.imageView == other.ImageInfo.imageView && ImageInfo.sampler == other.ImageInfo.sampler && ImageInfo.imageLayout == other.ImageInfo.imageLayout;
+}
+
+DescriptorSetKey& DescriptorSetKey::AddBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	DescriptorBinding descriptor;
+	descriptor.Binding = binding;
+	descriptor.Type = type;
+	descriptor.BufferInfo.buffer = buffer;
+	descriptor.BufferInfo.offset = offset;
+	descriptor.BufferInfo.range = range;
+	Bindings.push_back(descriptor);
+	return *this;
+}
+
+DescriptorSetKey& DescriptorSetKey::AddImage(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout)
+{
+	DescriptorBinding descriptor;
+	descriptor.Binding = binding;
+	descriptor.Type = type;
+	descriptor.ImageInfo.imageView = imageView;
+	descriptor.ImageInfo.sampler = sampler;
+	descriptor.ImageInfo.imageLayout = imageLayout;
+	Bindings.push_back(descriptor);
+	return *this;
+}
+
+bool DescriptorSetKey::operator==(const DescriptorSetKey& other) const
+{
+	return Layout == other.Layout && Bindings == other.Bindings;
+}
+
+size_t DescriptorSetKeyHash::operator()(const DescriptorSetKey& key) const
+{
+	size_t seed = 0;
+	auto combine = [&seed](uint64_t value) {
+		seed ^= std::hash<uint64_t>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	};
+
+	combine((uint64_t)key.Layout);
+	for (const auto& binding : key.Bindings)
+	{
+		combine(binding.Binding);
+		combine(static_cast<uint64_t>(binding.Type));
+		combine((uint64_t)binding.BufferInfo.buffer);
+		combine(binding.BufferInfo.offset);
+		combine(binding.BufferInfo.range);
+		combine((uint64_t)binding.ImageInfo.imageView);
+		combine((uint64_t)binding.ImageInfo.sampler);
+		combine(static_cast<uint64_t>(binding.ImageInfo.imageLayout));
+	}
+	return seed;
+}
+
+DescriptorAllocator::DescriptorAllocator()
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+}
+
+void DescriptorAllocator::Create(VkDevice device, uint32_t frameCount, uint32_t initialSetsPerPool, const std::vector<DescriptorPoolSizeRatio>& ratios)
+{
+	Device = device;
+	Ratios = ratios;
+	SetsPerPool = std::max(initialSetsPerPool, 1u);
+	Frames.resize(frameCount);
+}
+
+void DescriptorAllocator::Destroy()
+{
+	DestroyChain(Persistent);
+	for (auto& frame : Frames)
+	{
+		DestroyChain(frame);
+	}
+	Frames.clear();
+
+	for (auto pool : FreePools)
+	{
+		vkDestroyDescriptorPool(Device, pool, nullptr);
+	}
+	FreePools.clear();
+
+	Cache.clear();
+}
+
+void DescriptorAllocator::DestroyChain(PoolChain& chain)
+{
+	if (chain.Current != VK_NULL_HANDLE)
+	{
+		vkDestroyDescriptorPool(Device, chain.Current, nullptr);
+	}
+	for (auto pool : chain.FullPools)
+	{
+		vkDestroyDescriptorPool(Device, pool, nullptr);
+	}
+	chain = PoolChain();
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool()
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (const auto& ratio : Ratios)
+	{
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = ratio.Type;
+		poolSize.descriptorCount = std::max(static_cast<uint32_t>(ratio.Ratio * SetsPerPool), 1u);
+		poolSizes.push_back(poolSize);
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = SetsPerPool;
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(Device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create descriptor pool!");
+	}
+
+	//Every chain that outgrows its pools is likely to keep growing, so each new pool is twice the last.
+	SetsPerPool = std::min(SetsPerPool * 2, MaxSetsPerPool);
+	PoolCount++;
+
+	return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::AcquirePool()
+{
+	if (!FreePools.empty())
+	{
+		VkDescriptorPool pool = FreePools.back();
+		FreePools.pop_back();
+		return pool;
+	}
+
+	return CreatePool();
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(PoolChain& chain, VkDescriptorSetLayout layout)
+{
+	if (chain.Current == VK_NULL_HANDLE)
+	{
+		chain.Current = AcquirePool();
+	}
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = chain.Current;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet descriptorSet;
+	VkResult result = vkAllocateDescriptorSets(Device, &allocInfo, &descriptorSet);
+
+	if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+	{
+		chain.FullPools.push_back(chain.Current);
+		chain.Current = AcquirePool();
+		allocInfo.descriptorPool = chain.Current;
+		result = vkAllocateDescriptorSets(Device, &allocInfo, &descriptorSet);
+	}
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate descriptor set!");
+	}
+
+	AllocationCount++;
+	return descriptorSet;
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	return Allocate(Persistent, layout);
+}
+
+VkDescriptorSet DescriptorAllocator::AllocateTransient(uint32_t frame, VkDescriptorSetLayout layout)
+{
+	return Allocate(Frames[frame], layout);
+}
+
+void DescriptorAllocator::ResetFrame(uint32_t frame)
+{
+	PoolChain& chain = Frames[frame];
+	if (chain.Current == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	chain.FullPools.push_back(chain.Current);
+	for (auto pool : chain.FullPools)
+	{
+		vkResetDescriptorPool(Device, pool, 0);
+		FreePools.push_back(pool);
+	}
+	chain = PoolChain();
+}
+
+VkDescriptorSet DescriptorAllocator::GetCachedSet(const DescriptorSetKey& key)
+{
+	auto it = Cache.find(key);
+	if (it != Cache.end())
+	{
+		CacheHitCount++;
+		return it->second;
+	}
+
+	VkDescriptorSet descriptorSet = Allocate(Persistent, key.Layout);
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites(key.Bindings.size());
+	for (size_t i = 0; i < key.Bindings.size(); i++)
+	{
+		const DescriptorBinding& binding = key.Bindings[i];
+		bool isImage = binding.ImageInfo.imageView != VK_NULL_HANDLE || binding.ImageInfo.sampler != VK_NULL_HANDLE;
+
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptorSet;
+		descriptorWrites[i].dstBinding = binding.Binding;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = binding.Type;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = isImage ? nullptr : &binding.BufferInfo;
+		descriptorWrites[i].pImageInfo = isImage ? &binding.ImageInfo : nullptr;
+	}
+
+	vkUpdateDescriptorSets(Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+	Cache.emplace(key, descriptorSet);
+	return descriptorSet;
+}
+
+void DescriptorAllocator::PrintStats(std::ostream& out)
+{
+	out << "Descriptor allocator: " << AllocationCount << " sets from " << PoolCount << " pools, "
+		<< Cache.size() << " cached sets, " << CacheHitCount << " cache hits" << std::endl;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+
+struct DescriptorPoolSizeRatio
+{
+	VkDescriptorType Type;
+	float Ratio;
+};
+
+struct DescriptorBinding
+{
+	uint32_t Binding = 0;
+	VkDescriptorType Type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	VkDescriptorBufferInfo BufferInfo = {};
+	VkDescriptorImageInfo ImageInfo = {};
+
+	bool operator==(const DescriptorBinding& other) const;
+};
+
+//Identifies a fully written descriptor set: the layout plus what every binding points at.
+struct DescriptorSetKey
+{
+	VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+	std::vector<DescriptorBinding> Bindings;
+
+	DescriptorSetKey& AddBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	DescriptorSetKey& AddImage(uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout);
+
+	bool operator==(const DescriptorSetKey& other) const;
+};
+
+struct DescriptorSetKeyHash
+{
+	size_t operator()(const DescriptorSetKey& key) const;
+};
+
+//Hands out descriptor sets from chains of pools so callers never size pools by hand. When a pool runs out
+//(VK_ERROR_OUT_OF_POOL_MEMORY / VK_ERROR_FRAGMENTED_POOL) the next one is taken from the free list or created twice
+//as large. Persistent sets live until Destroy(); transient sets come from a per-frame chain that ResetFrame() resets in
+//bulk, returning its pools to the free list. GetCachedSet() allocates and writes a persistent set once per key.
+class DescriptorAllocator
+{
+private:
+	struct PoolChain
+	{
+		VkDescriptorPool Current = VK_NULL_HANDLE;
+		std::vector<VkDescriptorPool> FullPools;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	std::vector<DescriptorPoolSizeRatio> Ratios;
+	uint32_t SetsPerPool = 0;
+
+	std::vector<VkDescriptorPool> FreePools;
+	PoolChain Persistent;
+	std::vector<PoolChain> Frames;
+	std::unordered_map<DescriptorSetKey, VkDescriptorSet, DescriptorSetKeyHash> Cache;
+
+	uint32_t PoolCount = 0;
+	uint64_t AllocationCount = 0;
+	uint64_t CacheHitCount = 0;
+
+	VkDescriptorPool CreatePool();
+	VkDescriptorPool AcquirePool();
+	VkDescriptorSet Allocate(PoolChain& chain, VkDescriptorSetLayout layout);
+	void DestroyChain(PoolChain& chain);
+
+public:
+	static constexpr uint32_t MaxSetsPerPool = 4096;
+
+	DescriptorAllocator();
+	~DescriptorAllocator();
+
+	//ratios gives the descriptors of each type reserved per set in every pool.
+	void Create(VkDevice device, uint32_t frameCount, uint32_t initialSetsPerPool, const std::vector<DescriptorPoolSizeRatio>& ratios);
+	void Destroy();
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+	//Valid until the next ResetFrame(frame); only call that once the frame's fence has signalled.
+	VkDescriptorSet AllocateTransient(uint32_t frame, VkDescriptorSetLayout layout);
+	void ResetFrame(uint32_t frame);
+
+	VkDescriptorSet GetCachedSet(const DescriptorSetKey& key);
+
+	void PrintStats(std::ostream& out);
+};
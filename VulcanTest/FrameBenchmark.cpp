@@ -0,0 +1,271 @@
+#include "FrameBenchmark.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <regex>
+#include <map>
+#include <cmath>
+#include <stdexcept>
+
+static const char* FrameSeriesName = "frame";
+
+const char* FrameBenchmark::GetPhaseName(Phase phase)
+{
+	switch (phase)
+	{
+	case FenceWait: return "fence_wait";
+	case Housekeeping: return "housekeeping";
+	case Acquire: return "acquire";
+	case UniformUpdate: return "uniform_update";
+	case TextureStreaming: return "texture_streaming";
+	case Record: return "record";
+	case Submit: return "submit";
+	case Present: return "present";
+	default: return "unknown";
+	}
+}
+
+//Nearest-rank percentiles over the sorted samples.
+TimingSummary FrameBenchmark::Summarize(std::vector<double> samples)
+{
+	TimingSummary summary;
+	if (samples.empty())
+	{
+		return summary;
+	}
+
+	std::sort(samples.begin(), samples.end());
+	auto percentile = [&samples](double p) {
+		size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+		return samples[std::min(std::max(rank, static_cast<size_t>(1)), samples.size()) - 1];
+	};
+
+	double sum = 0.0;
+	for (double sample : samples)
+	{
+		sum += sample;
+	}
+
+	summary.Count = static_cast<uint32_t>(samples.size());
+	summary.Mean = sum / samples.size();
+	summary.P50 = percentile(0.50);
+	summary.P95 = percentile(0.95);
+	summary.P99 = percentile(0.99);
+	summary.Max = samples.back();
+	return summary;
+}
+
+void FrameBenchmark::Create(uint32_t warmUpFrameCount, uint32_t measuredFrameCount)
+{
+	Enabled = measuredFrameCount > 0;
+	WarmUpFrameCount = warmUpFrameCount;
+	MeasuredFrameCount = measuredFrameCount;
+	FrameIndex = 0;
+
+	AllSeries.clear();
+	AllSeries.push_back({ FrameSeriesName, {} });
+	for (uint32_t i = 0; i < PhaseCount; i++)
+	{
+		AllSeries.push_back({ GetPhaseName(static_cast<Phase>(i)), {} });
+	}
+	for (auto& series : AllSeries)
+	{
+		series.Samples.reserve(measuredFrameCount);
+	}
+}
+
+FrameBenchmark::Series& FrameBenchmark::FindSeries(const std::string& name)
+{
+	for (auto& series : AllSeries)
+	{
+		if (series.Name == name)
+		{
+			return series;
+		}
+	}
+
+	AllSeries.push_back({ name, {} });
+	AllSeries.back().Samples.reserve(MeasuredFrameCount);
+	return AllSeries.back();
+}
+
+void FrameBenchmark::BeginFrame()
+{
+	if (!Enabled)
+	{
+		return;
+	}
+
+	FrameActive = true;
+	FrameStart = Clock::now();
+	LastMark = FrameStart;
+	std::fill(std::begin(PhaseTimes), std::end(PhaseTimes), 0.0);
+}
+
+void FrameBenchmark::Mark(Phase phase)
+{
+	if (!FrameActive)
+	{
+		return;
+	}
+
+	Clock::time_point now = Clock::now();
+	PhaseTimes[phase] += std::chrono::duration<double, std::milli>(now - LastMark).count();
+	LastMark = now;
+}
+
+void FrameBenchmark::EndFrame()
+{
+	if (!FrameActive)
+	{
+		return;
+	}
+	FrameActive = false;
+
+	if (IsMeasuring())
+	{
+		AllSeries[0].Samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - FrameStart).count());
+		for (uint32_t i = 0; i < PhaseCount; i++)
+		{
+			AllSeries[1 + i].Samples.push_back(PhaseTimes[i]);
+		}
+	}
+	FrameIndex++;
+}
+
+void FrameBenchmark::CancelFrame()
+{
+	FrameActive = false;
+}
+
+void FrameBenchmark::AddSample(const std::string& name, double value)
+{
+	if (IsMeasuring())
+	{
+		FindSeries(name).Samples.push_back(value);
+	}
+}
+
+void FrameBenchmark::AddInfo(const std::string& key, const std::string& value)
+{
+	std::string escaped = "\"";
+	for (char c : value)
+	{
+		if (c == '"' || c == '\\')
+		{
+			escaped += '\\';
+		}
+		escaped += c;
+	}
+	Info.push_back({ key, escaped + "\"" });
+}
+
+void FrameBenchmark::AddInfo(const std::string& key, double value)
+{
+	std::ostringstream text;
+	text << value;
+	Info.push_back({ key, text.str() });
+}
+
+void FrameBenchmark::WriteJson(std::ostream& out)
+{
+	out << std::fixed << std::setprecision(4);
+	out << "{" << std::endl;
+	out << "  \"warmup_frames\": " << WarmUpFrameCount << "," << std::endl;
+	out << "  \"measured_frames\": " << MeasuredFrameCount << "," << std::endl;
+	for (const auto& info : Info)
+	{
+		out << "  \"" << info.first << "\": " << info.second << "," << std::endl;
+	}
+
+	out << "  \"series\": {" << std::endl;
+	for (size_t i = 0; i < AllSeries.size(); i++)
+	{
+		TimingSummary summary = Summarize(AllSeries[i].Samples);
+		out << "    \"" << AllSeries[i].Name << "\": { \"count\": " << summary.Count << ", \"mean\": " << summary.Mean << ", \"p50\": " << summary.P50
+			<< ", \"p95\": " << summary.P95 << ", \"p99\": " << summary.P99 << ", \"max\": " << summary.Max << " }" << (i + 1 < AllSeries.size() ? "," : "") << std::endl;
+	}
+	out << "  }" << std::endl;
+	out << "}" << std::endl;
+}
+
+void FrameBenchmark::WriteJson(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to write benchmark results to " + path + "!");
+	}
+	WriteJson(file);
+}
+
+void FrameBenchmark::PrintSummary(std::ostream& out)
+{
+	out << "Benchmark: " << MeasuredFrameCount << " frames after " << WarmUpFrameCount << " warm-up frames (ms)" << std::endl;
+	for (const auto& series : AllSeries)
+	{
+		TimingSummary summary = Summarize(series.Samples);
+		out << "  " << series.Name << ": mean " << summary.Mean << ", p50 " << summary.P50 << ", p95 " << summary.P95 << ", p99 " << summary.P99
+			<< ", max " << summary.Max << std::endl;
+	}
+}
+
+//Reads back the "series" objects of a file written by WriteJson(); each is a flat object of numbers.
+static std::map<std::string, std::map<std::string, double>> ReadSeries(const std::string& path)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open benchmark baseline " + path + "!");
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+	std::string json = text.str();
+
+	std::map<std::string, std::map<std::string, double>> result;
+	std::regex objectPattern("\"([A-Za-z0-9_./ -]+)\"\\s*:\\s*\\{([^{}]*)\\}");
+	std::regex fieldPattern("\"([A-Za-z0-9_]+)\"\\s*:\\s*([-+0-9.eE]+)");
+	for (std::sregex_iterator object(json.begin(), json.end(), objectPattern), end; object != end; ++object)
+	{
+		std::string body = (*object)[2];
+		auto& fields = result[(*object)[1]];
+		for (std::sregex_iterator field(body.begin(), body.end(), fieldPattern); field != end; ++field)
+		{
+			fields[(*field)[1]] = std::stod((*field)[2]);
+		}
+	}
+	return result;
+}
+
+bool FrameBenchmark::CompareWithBaseline(const std::string& path, double tolerance, std::ostream& out)
+{
+	auto baseline = ReadSeries(path);
+	bool regressed = false;
+
+	out << "Benchmark: comparing with " << path << " (tolerance " << tolerance * 100.0 << "%)" << std::endl;
+	for (const auto& series : AllSeries)
+	{
+		auto previous = baseline.find(series.Name);
+		if (previous == baseline.end())
+		{
+			continue;
+		}
+
+		TimingSummary summary = Summarize(series.Samples);
+		std::pair<const char*, double> current[] = { { "mean", summary.Mean }, { "p50", summary.P50 }, { "p95", summary.P95 } };
+		for (const auto& statistic : current)
+		{
+			auto value = previous->second.find(statistic.first);
+			if (value == previous->second.end() || value->second <= 0.0 || statistic.second <= value->second * (1.0 + tolerance))
+			{
+				continue;
+			}
+
+			out << "  " << series.Name << " " << statistic.first << ": " << value->second << " -> " << statistic.second << " ms (+"
+				<< (statistic.second / value->second - 1.0) * 100.0 << "%)" << std::endl;
+			regressed = regressed || series.Name == FrameSeriesName;
+		}
+	}
+
+	out << (regressed ? "  frame time regressed" : "  frame time within tolerance") << std::endl;
+	return regressed;
+}
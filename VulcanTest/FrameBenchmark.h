@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+
+struct TimingSummary
+{
+	uint32_t Count = 0;
+	double Mean = 0.0;
+	double P50 = 0.0;
+	double P95 = 0.0;
+	double P99 = 0.0;
+	double Max = 0.0;
+};
+
+//Per-frame CPU timings for a fixed run: warm-up frames are discarded, then every measured frame records its total time
+//and the time spent in each phase of drawFrame. Other per-frame series (GPU times, counters) can be added by name.
+//Summaries are written as JSON and can be checked against a previous run's file to catch regressions.
+class FrameBenchmark
+{
+public:
+	enum Phase
+	{
+		FenceWait,
+		Housekeeping,
+		Acquire,
+		UniformUpdate,
+		TextureStreaming,
+		Record,
+		Submit,
+		Present,
+		PhaseCount
+	};
+
+private:
+	struct Series
+	{
+		std::string Name;
+		std::vector<double> Samples;
+	};
+
+	typedef std::chrono::high_resolution_clock Clock;
+
+	bool Enabled = false;
+	uint32_t WarmUpFrameCount = 0;
+	uint32_t MeasuredFrameCount = 0;
+	uint32_t FrameIndex = 0;
+	bool FrameActive = false;
+	Clock::time_point FrameStart;
+	Clock::time_point LastMark;
+	double PhaseTimes[PhaseCount] = {};
+
+	//Series 0 is the whole frame, followed by one per phase and then any added by name.
+	std::vector<Series> AllSeries;
+	std::vector<std::pair<std::string, std::string>> Info;
+
+	Series& FindSeries(const std::string& name);
+	bool IsMeasuring() const { return Enabled && FrameIndex >= WarmUpFrameCount && FrameIndex < WarmUpFrameCount + MeasuredFrameCount; }
+
+public:
+	static const char* GetPhaseName(Phase phase);
+	static TimingSummary Summarize(std::vector<double> samples);
+
+	void Create(uint32_t warmUpFrameCount, uint32_t measuredFrameCount);
+	bool IsEnabled() const { return Enabled; }
+	//True once every measured frame has been recorded; always true when disabled.
+	bool IsFinished() const { return !Enabled || FrameIndex >= WarmUpFrameCount + MeasuredFrameCount; }
+
+	void BeginFrame();
+	//Charges the time since the previous mark (or BeginFrame) to phase.
+	void Mark(Phase phase);
+	void EndFrame();
+	//Drops the current frame, e.g. when the swapchain had to be recreated.
+	void CancelFrame();
+
+	//Adds a value for the current frame to a named series; ignored outside measured frames.
+	void AddSample(const std::string& name, double value);
+	void AddInfo(const std::string& key, const std::string& value);
+	void AddInfo(const std::string& key, double value);
+
+	void WriteJson(std::ostream& out);
+	void WriteJson(const std::string& path);
+	void PrintSummary(std::ostream& out);
+
+	//Compares the whole-frame mean, p50 and p95 with a file written by WriteJson(). Prints every series that is slower by
+	//more than tolerance (a fraction) and returns whether the frame time regressed.
+	bool CompareWithBaseline(const std::string& path, double tolerance, std::ostream& out);
+};
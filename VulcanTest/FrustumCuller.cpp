@@ -0,0 +1,228 @@
+#include "FrustumCuller.h"
+#include "BufferManager.h"
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+struct CullParams
+{
+	BoundingSphere MeshBounds;
+	uint32_t InstanceCount;
+	uint32_t DrawItemCount;
+};
+
+FrustumCuller::FrustumCuller()
+{
+}
+
+FrustumCuller::~FrustumCuller()
+{
+}
+
+void FrustumCuller::Create(MemoryAllocator& allocator, VkDevice device, PipelineCache& pipelineCache, DescriptorAllocator& descriptorAllocator, const AssetView& shaderCode, VkBuffer instanceBuffer, VkDeviceSize instanceSize, uint32_t instanceCount,
+	VkBuffer textureSlotBuffer, const std::vector<VkDrawIndexedIndirectCommand>& drawItems, uint32_t frameCount)
+{
+	Allocator = &allocator;
+	Device = device;
+	InstanceCount = instanceCount;
+	DrawItemCount = static_cast<uint32_t>(drawItems.size());
+
+	//The per-frame reset is a vkCmdUpdateBuffer of the draw count and the commands with zero instances.
+	ResetData.assign(CommandOffset / sizeof(uint32_t), 0);
+	for (const auto& drawItem : drawItems)
+	{
+		VkDrawIndexedIndirectCommand command = drawItem;
+		command.instanceCount = 0;
+		command.firstInstance = 0;
+
+		size_t offset = ResetData.size();
+		ResetData.resize(offset + sizeof(command) / sizeof(uint32_t));
+		memcpy(&ResetData[offset], &command, sizeof(command));
+	}
+
+	VkDeviceSize indirectSize = ResetData.size() * sizeof(uint32_t);
+	if (indirectSize > 65536) {
+		throw std::runtime_error("too many draw items for indirect culling!");
+	}
+
+	Frames.resize(frameCount);
+	for (auto& frame : Frames)
+	{
+		BufferManager::CreateBuffer(allocator, device, instanceSize * std::max(instanceCount, 1u), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.VisibleInstanceBuffer, frame.VisibleInstanceMemory);
+		BufferManager::CreateBuffer(allocator, device, indirectSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.IndirectBuffer, frame.IndirectMemory);
+	}
+
+	CreatePipeline(pipelineCache, shaderCode);
+	CreateDescriptorSets(descriptorAllocator, instanceBuffer, instanceSize * std::max(instanceCount, 1u), textureSlotBuffer);
+}
+
+void FrustumCuller::Destroy()
+{
+	for (auto& frame : Frames)
+	{
+		vkDestroyBuffer(Device, frame.VisibleInstanceBuffer, nullptr);
+		Allocator->Free(frame.VisibleInstanceMemory);
+		vkDestroyBuffer(Device, frame.IndirectBuffer, nullptr);
+		Allocator->Free(frame.IndirectMemory);
+	}
+	Frames.clear();
+
+	vkDestroyPipeline(Device, Pipeline, nullptr);
+	vkDestroyPipelineLayout(Device, PipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(Device, DescriptorSetLayout, nullptr);
+}
+
+void FrustumCuller::CreatePipeline(PipelineCache& pipelineCache, const AssetView& shaderCode)
+{
+	std::array<VkDescriptorSetLayoutBinding, 5> bindings = {};
+	bindings[0].binding = 0;
+	bindings[0].descriptorCount = 1;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	for (uint32_t i = 1; i < bindings.size(); i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorCount = 1;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutInfo.pBindings = bindings.data();
+
+	if (vkCreateDescriptorSetLayout(Device, &layoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling descriptor set layout!");
+	}
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullParams);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &DescriptorSetLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(Device, &pipelineLayoutInfo, nullptr, &PipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling pipeline layout!");
+	}
+
+	VkShaderModuleCreateInfo moduleInfo = {};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = shaderCode.Size;
+	moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.Data);
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(Device, &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.pNext = pipelineCache.BeginCreate(1);
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = shaderModule;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = PipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(Device, pipelineCache.GetCache(), 1, &pipelineInfo, nullptr, &Pipeline);
+	pipelineCache.EndCreate("culling pipeline");
+	vkDestroyShaderModule(Device, shaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to create culling pipeline!");
+	}
+}
+
+void FrustumCuller::CreateDescriptorSets(DescriptorAllocator& descriptorAllocator, VkBuffer instanceBuffer, VkDeviceSize instanceRange, VkBuffer textureSlotBuffer)
+{
+	//The sets live as long as the allocator's persistent pools; there is nothing to free in Destroy().
+	for (auto& frame : Frames)
+	{
+		frame.DescriptorSet = descriptorAllocator.Allocate(DescriptorSetLayout);
+
+		std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+		bufferInfos[0].buffer = instanceBuffer;
+		bufferInfos[0].range = instanceRange;
+		bufferInfos[1].buffer = frame.VisibleInstanceBuffer;
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+		bufferInfos[2].buffer = frame.IndirectBuffer;
+		bufferInfos[2].range = VK_WHOLE_SIZE;
+		bufferInfos[3].buffer = textureSlotBuffer;
+		bufferInfos[3].range = VK_WHOLE_SIZE;
+
+		std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+		for (uint32_t binding = 0; binding < descriptorWrites.size(); binding++)
+		{
+			descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[binding].dstSet = frame.DescriptorSet;
+			descriptorWrites[binding].dstBinding = binding + 1;
+			descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[binding].descriptorCount = 1;
+			descriptorWrites[binding].pBufferInfo = &bufferInfos[binding];
+		}
+
+		vkUpdateDescriptorSets(Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+void FrustumCuller::SetUniformBuffer(VkBuffer uniformBuffer, VkDeviceSize range)
+{
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = uniformBuffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = range;
+
+	for (auto& frame : Frames)
+	{
+		VkWriteDescriptorSet descriptorWrite = {};
+		descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrite.dstSet = frame.DescriptorSet;
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+		descriptorWrite.descriptorCount = 1;
+		descriptorWrite.pBufferInfo = &bufferInfo;
+
+		vkUpdateDescriptorSets(Device, 1, &descriptorWrite, 0, nullptr);
+	}
+}
+
+void FrustumCuller::RecordCull(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t uniformOffset, const BoundingSphere& meshBounds)
+{
+	FrameResources& resources = Frames[frame];
+
+	vkCmdUpdateBuffer(commandBuffer, resources.IndirectBuffer, 0, ResetData.size() * sizeof(uint32_t), ResetData.data());
+
+	VkMemoryBarrier resetBarrier = {};
+	resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+	CullParams params = {};
+	params.MeshBounds = meshBounds;
+	params.InstanceCount = InstanceCount;
+	params.DrawItemCount = DrawItemCount;
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, Pipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, PipelineLayout, 0, 1, &resources.DescriptorSet, 1, &uniformOffset);
+	vkCmdPushConstants(commandBuffer, PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(params), &params);
+	vkCmdDispatch(commandBuffer, (InstanceCount + WorkgroupSize - 1) / WorkgroupSize, 1, 1);
+
+	VkMemoryBarrier cullBarrier = {};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include "MemoryAllocator.h"
+#include "PipelineCache.h"
+#include "DescriptorAllocator.h"
+#include "AssetReader.h"
+
+struct BoundingSphere
+{
+	float X = 0.0f;
+	float Y = 0.0f;
+	float Z = 0.0f;
+	float Radius = 0.0f;
+};
+
+//Culls instance bounding spheres against the view frustum in a compute shader and writes the survivors plus
+//VkDrawIndexedIndirectCommands for every draw item, so the draw itself is issued with vkCmdDrawIndexedIndirect(Count)
+//and the CPU never touches per-object data. Output buffers are per frame in flight.
+//Instances name their texture by TextureHandle; the pass copies survivors with the handle replaced by the bindless slot
+//it maps to in the texture slot table.
+//The indirect buffer holds a uint draw count at offset 0 followed by the commands at GetCommandOffset().
+class FrustumCuller
+{
+private:
+	struct FrameResources
+	{
+		VkBuffer VisibleInstanceBuffer = VK_NULL_HANDLE;
+		MemoryAllocation VisibleInstanceMemory;
+		VkBuffer IndirectBuffer = VK_NULL_HANDLE;
+		MemoryAllocation IndirectMemory;
+		VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+	};
+
+	MemoryAllocator* Allocator = nullptr;
+	VkDevice Device = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout DescriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout PipelineLayout = VK_NULL_HANDLE;
+	VkPipeline Pipeline = VK_NULL_HANDLE;
+
+	std::vector<FrameResources> Frames;
+	std::vector<uint32_t> ResetData;
+	uint32_t InstanceCount = 0;
+	uint32_t DrawItemCount = 0;
+
+	void CreatePipeline(PipelineCache& pipelineCache, const AssetView& shaderCode);
+	void CreateDescriptorSets(DescriptorAllocator& descriptorAllocator, VkBuffer instanceBuffer, VkDeviceSize instanceRange, VkBuffer textureSlotBuffer);
+
+public:
+	static constexpr uint32_t WorkgroupSize = 64;
+	static constexpr VkDeviceSize CommandOffset = 16;
+
+	FrustumCuller();
+	~FrustumCuller();
+
+	//instanceBuffer holds instanceCount InstanceData of instanceSize bytes each and needs STORAGE_BUFFER usage, as does
+	//textureSlotBuffer, the uint32_t slot per texture handle from TextureStreamer::GetSlotTableBuffer().
+	void Create(MemoryAllocator& allocator, VkDevice device, PipelineCache& pipelineCache, DescriptorAllocator& descriptorAllocator, const AssetView& shaderCode, VkBuffer instanceBuffer, VkDeviceSize instanceSize, uint32_t instanceCount,
+		VkBuffer textureSlotBuffer, const std::vector<VkDrawIndexedIndirectCommand>& drawItems, uint32_t frameCount);
+	void Destroy();
+
+	//Points the culling UBO binding at the scene's UNIFORM_BUFFER_DYNAMIC ring; call again whenever the ring is recreated.
+	void SetUniformBuffer(VkBuffer uniformBuffer, VkDeviceSize range);
+
+	//Records the reset, dispatch and barriers that make the frame's outputs ready for vertex input and indirect draws.
+	//Must be recorded outside a render pass.
+	void RecordCull(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t uniformOffset, const BoundingSphere& meshBounds);
+
+	VkBuffer GetVisibleInstanceBuffer(uint32_t frame) { return Frames[frame].VisibleInstanceBuffer; }
+	VkBuffer GetIndirectBuffer(uint32_t frame) { return Frames[frame].IndirectBuffer; }
+	VkDeviceSize GetCommandOffset() { return CommandOffset; }
+	VkDeviceSize GetDrawCountOffset() { return 0; }
+	uint32_t GetDrawItemCount() { return DrawItemCount; }
+};
@@ -0,0 +1,183 @@
+#include "GpuTimer.h"
+#include <stdexcept>
+#include <algorithm>
+
+GpuTimer::GpuTimer()
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+}
+
+void GpuTimer::Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, uint32_t maxScopesPerFrame)
+{
+	Device = device;
+	MaxScopes = maxScopesPerFrame;
+	Frames.assign(frameCount, FrameQueries());
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+	Supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f && MaxScopes > 0;
+	if (!Supported)
+	{
+		return;
+	}
+
+	TimestampPeriod = properties.limits.timestampPeriod;
+	TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = frameCount * MaxScopes * 2;
+
+	if (vkCreateQueryPool(Device, &poolInfo, nullptr, &QueryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create timestamp query pool!");
+	}
+}
+
+void GpuTimer::Destroy()
+{
+	if (QueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(Device, QueryPool, nullptr);
+		QueryPool = VK_NULL_HANDLE;
+	}
+
+	Supported = false;
+	Frames.clear();
+	LastResults.clear();
+}
+
+bool GpuTimer::Collect(uint32_t frame)
+{
+	FrameQueries& queries = Frames[frame];
+	if (!Supported || !queries.Pending || queries.ScopeNames.empty())
+	{
+		return false;
+	}
+	queries.Pending = false;
+
+	//No WAIT flag: the fence has signalled, so anything not available now was never written and is skipped.
+	uint32_t queryCount = static_cast<uint32_t>(queries.ScopeNames.size()) * 2;
+	Timestamps.resize(static_cast<size_t>(queryCount) * 2);
+	VkResult result = vkGetQueryPoolResults(Device, QueryPool, GetFirstQuery(frame), queryCount, Timestamps.size() * sizeof(uint64_t), Timestamps.data(),
+		2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		throw std::runtime_error("failed to read timestamp queries!");
+	}
+
+	LastResults.clear();
+	for (size_t scope = 0; scope < queries.ScopeNames.size(); scope++)
+	{
+		const uint64_t* begin = &Timestamps[scope * 4];
+		const uint64_t* end = &Timestamps[scope * 4 + 2];
+		if (begin[1] == 0 || end[1] == 0)
+		{
+			continue;
+		}
+
+		//Masking and subtracting in unsigned arithmetic also handles a counter that wrapped between the two.
+		uint64_t ticks = ((end[0] & TimestampMask) - (begin[0] & TimestampMask)) & TimestampMask;
+
+		GpuTiming timing;
+		timing.Name = queries.ScopeNames[scope];
+		timing.Milliseconds = ticks * TimestampPeriod / 1000000.0;
+		LastResults.push_back(timing);
+
+		auto stats = std::find_if(Stats.begin(), Stats.end(), [&timing](const ScopeStats& entry) { return entry.Name == timing.Name; });
+		if (stats == Stats.end())
+		{
+			Stats.push_back(ScopeStats());
+			stats = Stats.end() - 1;
+			stats->Name = timing.Name;
+		}
+		stats->Total += timing.Milliseconds;
+		stats->Max = std::max(stats->Max, timing.Milliseconds);
+		stats->Count++;
+	}
+
+	return !LastResults.empty();
+}
+
+void GpuTimer::Reset(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	Frames[frame].ScopeNames.clear();
+	Frames[frame].Pending = false;
+
+	if (Supported)
+	{
+		vkCmdResetQueryPool(commandBuffer, QueryPool, GetFirstQuery(frame), MaxScopes * 2);
+	}
+}
+
+uint32_t GpuTimer::AddScope(uint32_t frame, const std::string& name)
+{
+	FrameQueries& queries = Frames[frame];
+	if (!Supported)
+	{
+		return 0;
+	}
+	if (queries.ScopeNames.size() >= MaxScopes)
+	{
+		throw std::runtime_error("too many GPU timer scopes in one frame!");
+	}
+
+	queries.ScopeNames.push_back(name);
+	queries.Pending = true;
+	return static_cast<uint32_t>(queries.ScopeNames.size() - 1);
+}
+
+void GpuTimer::WriteBegin(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t scope)
+{
+	if (Supported)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, QueryPool, GetFirstQuery(frame) + scope * 2);
+	}
+}
+
+void GpuTimer::WriteEnd(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t scope)
+{
+	if (Supported)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, QueryPool, GetFirstQuery(frame) + scope * 2 + 1);
+	}
+}
+
+double GpuTimer::GetAverage(const std::string& name) const
+{
+	for (const auto& stats : Stats)
+	{
+		if (stats.Name == name && stats.Count > 0)
+		{
+			return stats.Total / stats.Count;
+		}
+	}
+	return 0.0;
+}
+
+void GpuTimer::PrintStats(std::ostream& out)
+{
+	//Stats survive Destroy(), so this can be printed during shutdown.
+	if (Stats.empty())
+	{
+		out << "GPU timer: no timestamps collected" << std::endl;
+		return;
+	}
+
+	out << "GPU timer:" << std::endl;
+	for (const auto& stats : Stats)
+	{
+		out << "  " << stats.Name << ": " << (stats.Count > 0 ? stats.Total / stats.Count : 0.0) << " ms average, " << stats.Max << " ms max over "
+			<< stats.Count << " frames" << std::endl;
+	}
+}
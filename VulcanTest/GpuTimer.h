@@ -0,0 +1,71 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <string>
+#include <ostream>
+
+struct GpuTiming
+{
+	std::string Name;
+	double Milliseconds = 0.0;
+};
+
+//Measures GPU time with timestamp queries. Every frame in flight owns its own range of the query pool, and a scope is a
+//pair of timestamps in that range. A frame's results are read back once its fence has signalled, MAX_FRAMES_IN_FLIGHT
+//frames after they were recorded, so reading never waits on the GPU. Without timestamp support every call is a no-op.
+class GpuTimer
+{
+private:
+	struct FrameQueries
+	{
+		std::vector<std::string> ScopeNames;
+		bool Pending = false;
+	};
+
+	struct ScopeStats
+	{
+		std::string Name;
+		double Total = 0.0;
+		double Max = 0.0;
+		uint32_t Count = 0;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkQueryPool QueryPool = VK_NULL_HANDLE;
+	bool Supported = false;
+	uint32_t MaxScopes = 0;
+	//Nanoseconds per tick.
+	double TimestampPeriod = 0.0;
+	uint64_t TimestampMask = 0;
+
+	std::vector<FrameQueries> Frames;
+	std::vector<GpuTiming> LastResults;
+	std::vector<ScopeStats> Stats;
+	std::vector<uint64_t> Timestamps;
+
+	uint32_t GetFirstQuery(uint32_t frame) const { return frame * MaxScopes * 2; }
+
+public:
+	GpuTimer();
+	~GpuTimer();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameCount, uint32_t maxScopesPerFrame);
+	void Destroy();
+	bool IsSupported() const { return Supported; }
+
+	//Reads back the frame's previous results. Call after the frame's fence has signalled; returns false when there were none.
+	bool Collect(uint32_t frame);
+	//Resets the frame's queries and forgets its scopes. Must be recorded outside a render pass, ahead of every timestamp.
+	void Reset(VkCommandBuffer commandBuffer, uint32_t frame);
+	//Reserves a scope for this frame. Not thread safe: add scopes up front and hand the indices to recording threads.
+	uint32_t AddScope(uint32_t frame, const std::string& name);
+	//Can be recorded into primary or secondary buffers, inside or outside a render pass.
+	void WriteBegin(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t scope);
+	void WriteEnd(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t scope);
+
+	//Scopes of the most recently collected frame, in the order they were added.
+	const std::vector<GpuTiming>& GetResults() const { return LastResults; }
+	//Average of every collected sample of the named scope, 0.0 if it was never seen.
+	double GetAverage(const std::string& name) const;
+	void PrintStats(std::ostream& out);
+};
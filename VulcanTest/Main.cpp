@@ -8,6 +8,8 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
 
 #include <iostream>
 #include <fstream>
@@ -18,23 +20,78 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdint>
+#include <cmath>
 #include <array>
 #include <optional>
 #include <set>
+#include <deque>
+#include <thread>
 #include "VertexBuffer.h";
 #include "BufferManager.h";
+#include "MemoryAllocator.h"
+#include "UniformRingBuffer.h"
+#include "UploadContext.h"
+#include "StagingBufferPool.h"
+#include "CommandRecorder.h"
+#include "FrustumCuller.h"
+#include "MeshLoader.h"
+#include "PipelineCache.h"
+#include "BindlessTextures.h"
+#include "DescriptorAllocator.h"
+#include "TextureStreamer.h"
+#include "AssetReader.h"
+#include "FrameBenchmark.h"
+#include "GpuTimer.h"
+#include "PipelineStatistics.h"
+#include "Profiler.h"
 
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
 const int MAX_FRAMES_IN_FLIGHT = 2;
 
+const int MAX_UNIFORM_OBJECTS_PER_FRAME = 1024;
+
+const VkDeviceSize STAGING_BUFFER_BUDGET = 32 * 1024 * 1024;
+
+const uint32_t MAX_RECORDING_THREADS = 4;
+
+const uint32_t INSTANCE_COUNT = 16;
+
+const std::string PIPELINE_CACHE_PATH = "pipeline_cache.bin";
+
+//Mounted at startup when present; shaders, meshes and textures are looked up in it before the file system.
+const std::string ASSET_ARCHIVE_PATH = "assets.pak";
+
+const uint32_t MAX_BINDLESS_TEXTURES = 4096;
+
+const uint32_t DESCRIPTOR_SETS_PER_POOL = 16;
+
+const std::string TEXTURE_PATH = "C:/Users/ZZT/source/repos/VulkanTest/VulcanTest/texture/texture.jpg";
+
+const VkDeviceSize TEXTURE_UPLOAD_BUDGET = 8 * 1024 * 1024;
+
+//Headless runs render this many frames once texture streaming has settled, then read the last one back.
+const uint32_t HEADLESS_FRAME_COUNT = 60;
+//Fixed animation step for headless runs, so a given frame count always produces the same image.
+const float HEADLESS_FRAME_TIME = 1.0f / 60.0f;
+const VkFormat HEADLESS_COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+const uint32_t BENCHMARK_WARMUP_FRAMES = 100;
+const uint32_t BENCHMARK_FRAME_COUNT = 1000;
+//Fractional slowdown of the frame time mean, p50 or p95 against --baseline that fails the run.
+const double BENCHMARK_TOLERANCE = 0.10;
+
+const glm::vec3 CAMERA_POSITION = glm::vec3(2.0f, 2.0f, 2.0f);
+const float CAMERA_FOV_DEGREES = 45.0f;
+
 const std::vector<const char*> validationLayers = {
 	"VK_LAYER_KHRONOS_validation"
 };
 
 const std::vector<const char*> deviceExtensions = {
-	VK_KHR_SWAPCHAIN_EXTENSION_NAME
+	VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+	VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
 };
 
 #ifdef NDEBUG
@@ -63,6 +120,7 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 struct QueueFamilyIndices {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> transferFamily;
 
 	bool isComplete() {
 		return graphicsFamily.has_value() && presentFamily.has_value();
@@ -75,49 +133,26 @@ struct SwapChainSupportDetails {
 	std::vector<VkPresentModeKHR> presentModes;
 };
 
+//Everything that belonged to a replaced swapchain, kept alive until the frames that may still use it have finished.
+struct RetiredSwapChain {
+	VkSwapchainKHR swapChain;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkFramebuffer> framebuffers;
+	VkImage depthImage;
+	MemoryAllocation depthImageMemory;
+	VkImageView depthImageView;
+	//Headless render targets, which the swapchain owns otherwise.
+	std::vector<VkImage> offscreenImages;
+	std::vector<MemoryAllocation> offscreenImageMemory;
+	uint64_t lastFrame;
+};
+
 struct UniformBufferObject {
 	alignas(16) glm::mat4 model;
 	alignas(16) glm::mat4 view;
 	alignas(16) glm::mat4 proj;
 };
 
-
-struct Vertex {
-	glm::vec3 pos;
-	glm::vec3 color;
-	glm::vec2 texCoord;
-
-	static VkVertexInputBindingDescription getBindingDescription() {
-		VkVertexInputBindingDescription bindingDescription = {};
-		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(Vertex);
-		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-		return bindingDescription;
-	}
-
-	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions() {
-		std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions = {};
-
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
-		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[0].offset = offsetof(Vertex, pos);
-
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
-		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-		attributeDescriptions[1].offset = offsetof(Vertex, color);
-
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
-		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
-
-		return attributeDescriptions;
-	}
-};
-
 const std::vector<Vertex> vertices = {
 	{{-0.5f, -0.5f, 0.0f}, {1.0f, 0.0f, 0.0f}, {1.0f, 0.0f}},
 	{{0.5f, -0.5f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f}},
@@ -130,11 +165,16 @@ const std::vector<Vertex> vertices = {
 	{{-0.5f, 0.5f, -0.5f}, {1.0f, 1.0f, 1.0f}, {1.0f, 1.0f}}
 };
 
-const std::vector<uint16_t> indices = {
+const std::vector<uint32_t> indices = {
 	0, 1, 2, 2, 3, 0,
 	4, 5, 6, 6, 7, 4
 };
 
+const std::vector<MeshSubset> subsets = {
+	{0, 6},
+	{6, 6}
+};
+
 class VertexBuffer
 {
 private:
@@ -144,7 +184,7 @@ public:
 	~VertexBuffer();
 
 	VkPipelineVertexInputStateCreateInfo VertexInputInfo;
-	VkPipelineVertexInputStateCreateInfo SetUpVertexBuffer(VkVertexInputBindingDescription binding, std::array<VkVertexInputAttributeDescription, 3> attribute);
+	VkPipelineVertexInputStateCreateInfo SetUpVertexBuffer(const std::array<VkVertexInputBindingDescription, 2>& binding, const std::array<VkVertexInputAttributeDescription, 8>& attribute);
 	VkPipelineVertexInputStateCreateInfo GetVertexStateInfo() { return VertexInputInfo; }
 };
 
@@ -157,13 +197,13 @@ VertexBuffer::~VertexBuffer()
 {
 }
 
-VkPipelineVertexInputStateCreateInfo VertexBuffer::SetUpVertexBuffer(VkVertexInputBindingDescription binding, std::array<VkVertexInputAttributeDescription, 3> attribute)
+VkPipelineVertexInputStateCreateInfo VertexBuffer::SetUpVertexBuffer(const std::array<VkVertexInputBindingDescription, 2>& binding, const std::array<VkVertexInputAttributeDescription, 8>& attribute)
 {
 	VkPipelineVertexInputStateCreateInfo VertexInputInfo = {};
 	VertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	VertexInputInfo.vertexBindingDescriptionCount = 1;
+	VertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(binding.size());
 	VertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attribute.size());
-	VertexInputInfo.pVertexBindingDescriptions = &binding;
+	VertexInputInfo.pVertexBindingDescriptions = binding.data();
 	VertexInputInfo.pVertexAttributeDescriptions = attribute.data();
 	return VertexInputInfo;
 }
@@ -171,11 +211,40 @@ VkPipelineVertexInputStateCreateInfo VertexBuffer::SetUpVertexBuffer(VkVertexInp
 
 class HelloTriangleApplication {
 public:
+	std::string modelPath;
+	std::string texturePath = TEXTURE_PATH;
+	std::string archivePath = ASSET_ARCHIVE_PATH;
+	bool headless = false;
+	uint32_t headlessFrameCount = HEADLESS_FRAME_COUNT;
+	std::string outputPath;
+	std::string benchmarkPath;
+	std::string baselinePath;
+	uint32_t benchmarkWarmUpFrames = BENCHMARK_WARMUP_FRAMES;
+	uint32_t benchmarkFrameCount = BENCHMARK_FRAME_COUNT;
+	//Counts vertex, clipping and fragment work per frame when the device supports pipeline statistics queries.
+	bool pipelineStatisticsRequested = false;
+	std::string tracePath;
+
 	void run() {
-		initWindow();
+		startTrace();
+		if (!headless) {
+			initWindow();
+		}
 		initVulkan();
-		mainLoop();
+		if (headless) {
+			renderHeadless();
+		}
+		else {
+			startBenchmark();
+			mainLoop();
+		}
+		bool regressed = frameBenchmark.IsEnabled() && reportBenchmark();
 		cleanup();
+		writeTrace();
+
+		if (regressed) {
+			throw std::runtime_error("frame time regressed against " + baselinePath + "!");
+		}
 	}
 
 private:
@@ -183,59 +252,93 @@ private:
 
 	VkInstance instance;
 	VkDebugUtilsMessengerEXT debugMessenger;
-	VkSurfaceKHR surface;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
 
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device;
 
+	MemoryAllocator memoryAllocator;
+	PipelineCache pipelineCache;
+	bool pipelineCreationFeedbackSupported = false;
+
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue transferQueue;
 
-	VkSwapchainKHR swapChain;
+	VkSwapchainKHR swapChain = VK_NULL_HANDLE;
 	std::vector<VkImage> swapChainImages;
 	VkFormat swapChainImageFormat;
 	VkExtent2D swapChainExtent;
 	std::vector<VkImageView> swapChainImageViews;
 	std::vector<VkFramebuffer> swapChainFramebuffers;
+	std::deque<RetiredSwapChain> retiredSwapChains;
+	//Headless only: memory behind swapChainImages, which are plain offscreen images there.
+	std::vector<MemoryAllocation> offscreenImageMemory;
+	uint32_t lastImageIndex = 0;
 
 	VkRenderPass renderPass;
 	VkDescriptorSetLayout descriptorSetLayout;
 	VkPipelineLayout pipelineLayout;
 	VkPipeline graphicsPipeline;
 
-	VkCommandPool commandPool;
+	std::vector<VkCommandPool> commandPools;
+	UploadContext uploadContext;
+	StagingBufferPool stagingBufferPool;
+	CommandRecorder commandRecorder;
+	GpuTimer gpuTimer;
+	std::vector<uint32_t> drawGroupScopes;
+	PipelineStatistics pipelineStatistics;
+	std::vector<uint32_t> drawGroupQueries;
 
 	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
+	MemoryAllocation depthImageMemory;
 	VkImageView depthImageView;
 
-	VkImage textureImage;
-	VkDeviceMemory textureImageMemory;
-	VkImageView textureImageView;
 	VkSampler textureSampler;
+	BindlessTextures bindlessTextures;
+	TextureStreamer textureStreamer;
+	AssetReader assetReader;
+	TextureHandle textureHandle = 0;
 
+	MeshData mesh;
 	VkBuffer vertexBuffer;
-	VkDeviceMemory vertexBufferMemory;
+	MemoryAllocation vertexBufferMemory;
 	VkBuffer indexBuffer;
-	VkDeviceMemory indexBufferMemory;
+	MemoryAllocation indexBufferMemory;
+	VkBuffer instanceBuffer;
+	MemoryAllocation instanceBufferMemory;
+	uint32_t instanceCount = 0;
 
-	std::vector<VkBuffer> uniformBuffers;
-	std::vector<VkDeviceMemory> uniformBuffersMemory;
+	FrustumCuller frustumCuller;
+	BoundingSphere meshBounds;
+	std::vector<glm::mat4> instanceTransforms;
+	glm::mat4 sceneTransform = glm::mat4(1.0f);
+	bool multiDrawIndirectSupported = false;
+	bool pipelineStatisticsSupported = false;
+	PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount = nullptr;
 
-	VkDescriptorPool descriptorPool;
-	std::vector<VkDescriptorSet> descriptorSets;
+	UniformRingBuffer uniformRingBuffer;
+
+	DescriptorAllocator descriptorAllocator;
+	VkDescriptorSet uniformDescriptorSet;
 
 	std::vector<VkCommandBuffer> commandBuffers;
+	FrameBenchmark frameBenchmark;
+	std::chrono::duration<double, std::milli> recordingTime{ 0 };
+	uint64_t recordedFrameCount = 0;
 
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
 	std::vector<VkFence> inFlightFences;
 	std::vector<VkFence> imagesInFlight;
 	size_t currentFrame = 0;
+	uint64_t submittedFrameCount = 0;
+	uint64_t animationFrame = 0;
 
 	bool framebufferResized = false;
 
 	void initWindow() {
+		PROFILE_FUNCTION();
 		glfwInit();
 
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -251,33 +354,46 @@ private:
 	}
 
 	void initVulkan() {
+		PROFILE_FUNCTION();
+		mountAssets();
 		createInstance();
 		setupDebugMessenger();
 		createSurface();
 		pickPhysicalDevice();
 		createLogicalDevice();
+		createMemoryAllocator();
+		createPipelineCache();
+		createDescriptorAllocator();
 		createSwapChain();
 		createImageViews();
 		createRenderPass();
 		createDescriptorSetLayout();
+		createBindlessTextures();
 		createGraphicsPipeline();
 		createCommandPool();
+		createCommandRecorder();
+		createGpuProfiling();
+		createUploadContext();
+		createStagingBufferPool();
 		createDepthResources();
 		createFramebuffers();
-		createTextureImage();
-		createTextureImageView();
 		createTextureSampler();
+		createTextureStreamer();
+		loadModel();
 		createVertexBuffer();
 		createIndexBuffer();
+		createInstanceBuffer();
+		createFrustumCuller();
+		submitUploads();
 		createUniformBuffers();
-		createDescriptorPool();
 		createDescriptorSets();
 		createCommandBuffers();
 		createSyncObjects();
 	}
 
 	void mainLoop() {
-		while (!glfwWindowShouldClose(window)) {
+		//A windowed benchmark ends by itself once its frames are measured.
+		while (!glfwWindowShouldClose(window) && !(frameBenchmark.IsEnabled() && frameBenchmark.IsFinished())) {
 			glfwPollEvents();
 			drawFrame();
 		}
@@ -285,51 +401,252 @@ private:
 		vkDeviceWaitIdle(device);
 	}
 
-	void cleanupSwapChain() {
-		vkDestroyImageView(device, depthImageView, nullptr);
-		vkDestroyImage(device, depthImage, nullptr);
-		vkFreeMemory(device, depthImageMemory, nullptr);
+	//Renders until texture streaming has settled, then headlessFrameCount frames at a fixed time step, and writes the last
+	//one to outputPath. No window, surface or swapchain is involved, so this runs on render farms and under lavapipe.
+	void renderHeadless() {
+		PROFILE_FUNCTION();
+		uint32_t warmUpFrameCount = 0;
+		while (!textureStreamer.IsIdle()) {
+			drawFrame();
+			warmUpFrameCount++;
+		}
+		startBenchmark();
 
-		for (auto framebuffer : swapChainFramebuffers) {
-			vkDestroyFramebuffer(device, framebuffer, nullptr);
+		//A benchmark keeps going until its own warm-up and measured frames are done.
+		auto renderStart = std::chrono::high_resolution_clock::now();
+		uint32_t frameCount = 0;
+		for (; frameCount < headlessFrameCount || !frameBenchmark.IsFinished(); frameCount++) {
+			animationFrame = frameCount;
+			drawFrame();
 		}
+		vkDeviceWaitIdle(device);
+		std::chrono::duration<double, std::milli> renderTime = std::chrono::high_resolution_clock::now() - renderStart;
 
-		vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+		std::cout << "Headless: " << frameCount << " frames at " << swapChainExtent.width << "x" << swapChainExtent.height << " in " << renderTime.count() << " ms ("
+			<< renderTime.count() / std::max(frameCount, 1u) << " ms per frame) after " << warmUpFrameCount << " warm-up frames" << std::endl;
 
-		vkDestroyPipeline(device, graphicsPipeline, nullptr);
-		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-		vkDestroyRenderPass(device, renderPass, nullptr);
+		if (!outputPath.empty()) {
+			saveImage(swapChainImages[lastImageIndex], outputPath);
+		}
+	}
+
+	//Copies a color target left in TRANSFER_SRC_OPTIMAL by the render pass into host memory and writes it as a PNG.
+	void saveImage(VkImage image, const std::string& path) {
+		PROFILE_FUNCTION();
+		VkDeviceSize rowPitch = swapChainExtent.width * 4;
+		VkDeviceSize bufferSize = rowPitch * swapChainExtent.height;
+
+		VkBuffer readbackBuffer;
+		MemoryAllocation readbackBufferMemory;
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackBufferMemory);
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = commandPools[0];
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate readback command buffer!");
+		}
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+		VkImageMemoryBarrier imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = image;
+		imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+		VkBufferImageCopy region = {};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+		vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer, 1, &region);
+
+		VkBufferMemoryBarrier bufferBarrier = {};
+		bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.buffer = readbackBuffer;
+		bufferBarrier.offset = 0;
+		bufferBarrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record readback command buffer!");
+		}
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit readback command buffer!");
+		}
+		vkQueueWaitIdle(graphicsQueue);
+		vkFreeCommandBuffers(device, commandPools[0], 1, &commandBuffer);
+
+		bool written = stbi_write_png(path.c_str(), static_cast<int>(swapChainExtent.width), static_cast<int>(swapChainExtent.height), 4,
+			readbackBufferMemory.MappedData, static_cast<int>(rowPitch)) != 0;
+
+		vkDestroyBuffer(device, readbackBuffer, nullptr);
+		memoryAllocator.Free(readbackBufferMemory);
+
+		if (!written) {
+			throw std::runtime_error("failed to write " + path + "!");
+		}
+		std::cout << "Headless: wrote " << path << std::endl;
+	}
+
+	void startTrace() {
+		if (tracePath.empty()) {
+			return;
+		}
+		if (!Profiler::IsCompiledIn()) {
+			std::cerr << "Profiling zones are compiled out of this build; define VULCANTEST_PROFILING to trace a release build" << std::endl;
+			return;
+		}
+		Profiler::SetEnabled(true);
+		PROFILE_THREAD("main");
+	}
+
+	//Runs after cleanup, once every worker thread has been joined.
+	void writeTrace() {
+		if (!Profiler::IsEnabled()) {
+			return;
+		}
+		Profiler::SetEnabled(false);
+		Profiler::WriteChromeTrace(tracePath);
+		std::cout << "Trace: wrote " << tracePath << std::endl;
+	}
+
+	void startBenchmark() {
+		if (!benchmarkPath.empty()) {
+			frameBenchmark.Create(benchmarkWarmUpFrames, benchmarkFrameCount);
+		}
+	}
+
+	//Writes the benchmark JSON and returns whether the frame time regressed against the baseline, if one was given.
+	bool reportBenchmark() {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		frameBenchmark.AddInfo("device", properties.deviceName);
+		frameBenchmark.AddInfo("width", swapChainExtent.width);
+		frameBenchmark.AddInfo("height", swapChainExtent.height);
+		frameBenchmark.AddInfo("headless", headless ? 1.0 : 0.0);
+		frameBenchmark.AddInfo("instances", instanceCount);
+		frameBenchmark.AddInfo("triangles", static_cast<double>(mesh.Indices.size() / 3));
+		frameBenchmark.AddInfo("gpuTimestamps", gpuTimer.IsSupported() ? 1.0 : 0.0);
+
+		frameBenchmark.WriteJson(benchmarkPath);
+		frameBenchmark.PrintSummary(std::cout);
+		std::cout << "Benchmark: wrote " << benchmarkPath << std::endl;
 
-		for (auto imageView : swapChainImageViews) {
-			vkDestroyImageView(device, imageView, nullptr);
+		return !baselinePath.empty() && frameBenchmark.CompareWithBaseline(baselinePath, BENCHMARK_TOLERANCE, std::cout);
+	}
+
+	void cleanupSwapChain() {
+		retireSwapChain();
+		destroyRetiredSwapChains(UINT64_MAX);
+	}
+
+	//Hands the current swapchain's resources to the retire queue; every frame submitted so far may still reference them.
+	void retireSwapChain() {
+		RetiredSwapChain retired = {};
+		retired.swapChain = swapChain;
+		retired.imageViews = swapChainImageViews;
+		retired.framebuffers = swapChainFramebuffers;
+		retired.depthImage = depthImage;
+		retired.depthImageMemory = depthImageMemory;
+		retired.depthImageView = depthImageView;
+		if (headless) {
+			retired.offscreenImages = swapChainImages;
+			retired.offscreenImageMemory = offscreenImageMemory;
+			offscreenImageMemory.clear();
 		}
+		retired.lastFrame = submittedFrameCount;
+		retiredSwapChains.push_back(retired);
+
+		swapChainImageViews.clear();
+		swapChainFramebuffers.clear();
+	}
+
+	void destroyRetiredSwapChains(uint64_t completedFrameCount) {
+		while (!retiredSwapChains.empty() && retiredSwapChains.front().lastFrame <= completedFrameCount) {
+			RetiredSwapChain& retired = retiredSwapChains.front();
 
-		vkDestroySwapchainKHR(device, swapChain, nullptr);
+			vkDestroyImageView(device, retired.depthImageView, nullptr);
+			vkDestroyImage(device, retired.depthImage, nullptr);
+			memoryAllocator.Free(retired.depthImageMemory);
 
-		for (size_t i = 0; i < swapChainImages.size(); i++) {
-			vkDestroyBuffer(device, uniformBuffers[i], nullptr);
-			vkFreeMemory(device, uniformBuffersMemory[i], nullptr);
+			for (auto framebuffer : retired.framebuffers) {
+				vkDestroyFramebuffer(device, framebuffer, nullptr);
+			}
+
+			for (auto imageView : retired.imageViews) {
+				vkDestroyImageView(device, imageView, nullptr);
+			}
+
+			for (size_t i = 0; i < retired.offscreenImages.size(); i++) {
+				vkDestroyImage(device, retired.offscreenImages[i], nullptr);
+				memoryAllocator.Free(retired.offscreenImageMemory[i]);
+			}
+
+			if (retired.swapChain != VK_NULL_HANDLE) {
+				vkDestroySwapchainKHR(device, retired.swapChain, nullptr);
+			}
+
+			retiredSwapChains.pop_front();
 		}
+	}
 
-		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	void cleanupPipeline() {
+		vkDestroyPipeline(device, graphicsPipeline, nullptr);
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+		vkDestroyRenderPass(device, renderPass, nullptr);
 	}
 
 	void cleanup() {
+		PROFILE_FUNCTION();
 		cleanupSwapChain();
+		cleanupPipeline();
 
-		vkDestroySampler(device, textureSampler, nullptr);
-		vkDestroyImageView(device, textureImageView, nullptr);
+		uniformRingBuffer.Destroy(memoryAllocator, device);
 
-		vkDestroyImage(device, textureImage, nullptr);
-		vkFreeMemory(device, textureImageMemory, nullptr);
+		descriptorAllocator.Destroy();
+
+		textureStreamer.Destroy();
+		vkDestroySampler(device, textureSampler, nullptr);
 
 		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+		bindlessTextures.Destroy();
 
 		vkDestroyBuffer(device, indexBuffer, nullptr);
-		vkFreeMemory(device, indexBufferMemory, nullptr);
+		memoryAllocator.Free(indexBufferMemory);
 
 		vkDestroyBuffer(device, vertexBuffer, nullptr);
-		vkFreeMemory(device, vertexBufferMemory, nullptr);
+		memoryAllocator.Free(vertexBufferMemory);
+
+		frustumCuller.Destroy();
+
+		vkDestroyBuffer(device, instanceBuffer, nullptr);
+		memoryAllocator.Free(instanceBufferMemory);
 
 		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 			vkDestroySemaphore(device, renderFinishedSemaphores[i], nullptr);
@@ -337,7 +654,29 @@ private:
 			vkDestroyFence(device, inFlightFences[i], nullptr);
 		}
 
-		vkDestroyCommandPool(device, commandPool, nullptr);
+		pipelineStatistics.Destroy();
+		gpuTimer.Destroy();
+		commandRecorder.Destroy();
+		for (auto pool : commandPools) {
+			vkDestroyCommandPool(device, pool, nullptr);
+		}
+
+		uploadContext.Destroy();
+		stagingBufferPool.Destroy();
+
+		pipelineStatistics.PrintStats(std::cout, static_cast<uint64_t>(swapChainExtent.width) * swapChainExtent.height);
+
+		if (enableValidationLayers) {
+			memoryAllocator.PrintStats(std::cout);
+			pipelineCache.PrintStats(std::cout);
+			descriptorAllocator.PrintStats(std::cout);
+			gpuTimer.PrintStats(std::cout);
+			if (recordedFrameCount > 0) {
+				std::cout << "Command recording: " << recordingTime.count() / recordedFrameCount << " ms average over " << recordedFrameCount << " frames" << std::endl;
+			}
+		}
+		memoryAllocator.Destroy();
+		pipelineCache.Destroy();
 
 		vkDestroyDevice(device, nullptr);
 
@@ -345,15 +684,21 @@ private:
 			DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 		}
 
-		vkDestroySurfaceKHR(instance, surface, nullptr);
+		//Headless runs never create a surface or enable VK_KHR_surface.
+		if (!headless) {
+			vkDestroySurfaceKHR(instance, surface, nullptr);
+		}
 		vkDestroyInstance(instance, nullptr);
 
-		glfwDestroyWindow(window);
+		if (!headless) {
+			glfwDestroyWindow(window);
 
-		glfwTerminate();
+			glfwTerminate();
+		}
 	}
 
 	void recreateSwapChain() {
+		PROFILE_FUNCTION();
 		int width = 0, height = 0;
 		glfwGetFramebufferSize(window, &width, &height);
 		while (width == 0 || height == 0) {
@@ -361,23 +706,36 @@ private:
 			glfwWaitEvents();
 		}
 
-		vkDeviceWaitIdle(device);
+		auto recreateStart = std::chrono::high_resolution_clock::now();
 
-		cleanupSwapChain();
+		//The old swapchain is passed as oldSwapchain and its resources are destroyed from drawFrame once the frames
+		//that used them have signalled their fences, so the GPU keeps running through a resize.
+		//Viewport and scissor are dynamic and uniforms are per frame in flight, so only extent dependent resources are rebuilt.
+		retireSwapChain();
 
+		VkFormat previousFormat = swapChainImageFormat;
 		createSwapChain();
 		createImageViews();
-		createRenderPass();
-		createGraphicsPipeline();
+		if (swapChainImageFormat != previousFormat) {
+			//Frames in flight still use the old render pass and pipeline; a format change is rare enough to just drain the GPU.
+			vkDeviceWaitIdle(device);
+			cleanupPipeline();
+			createRenderPass();
+			createGraphicsPipeline();
+		}
 		createDepthResources();
 		createFramebuffers();
-		createUniformBuffers();
-		createDescriptorPool();
-		createDescriptorSets();
-		createCommandBuffers();
+
+		imagesInFlight.assign(swapChainImages.size(), VK_NULL_HANDLE);
+
+		if (enableValidationLayers) {
+			std::chrono::duration<double, std::milli> recreateTime = std::chrono::high_resolution_clock::now() - recreateStart;
+			std::cout << "Swapchain recreated at " << swapChainExtent.width << "x" << swapChainExtent.height << " in " << recreateTime.count() << " ms" << std::endl;
+		}
 	}
 
 	void createInstance() {
+		PROFILE_FUNCTION();
 		if (enableValidationLayers && !checkValidationLayerSupport()) {
 			throw std::runtime_error("validation layers requested, but not available!");
 		}
@@ -388,7 +746,7 @@ private:
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "No Engine";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = VK_API_VERSION_1_1;
 
 		VkInstanceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -426,6 +784,7 @@ private:
 	}
 
 	void setupDebugMessenger() {
+		PROFILE_FUNCTION();
 		if (!enableValidationLayers) return;
 
 		VkDebugUtilsMessengerCreateInfoEXT createInfo;
@@ -437,12 +796,16 @@ private:
 	}
 
 	void createSurface() {
+		PROFILE_FUNCTION();
+		if (headless) return;
+
 		if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create window surface!");
 		}
 	}
 
 	void pickPhysicalDevice() {
+		PROFILE_FUNCTION();
 		uint32_t deviceCount = 0;
 		vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
 
@@ -466,10 +829,14 @@ private:
 	}
 
 	void createLogicalDevice() {
+		PROFILE_FUNCTION();
 		QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+		if (indices.transferFamily.has_value()) {
+			uniqueQueueFamilies.insert(indices.transferFamily.value());
+		}
 
 		float queuePriority = 1.0f;
 		for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -481,19 +848,40 @@ private:
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		multiDrawIndirectSupported = supportedFeatures.multiDrawIndirect == VK_TRUE;
+		pipelineStatisticsSupported = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+
 		VkPhysicalDeviceFeatures deviceFeatures = {};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
+		deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+		deviceFeatures.pipelineStatisticsQuery = pipelineStatisticsRequested && pipelineStatisticsSupported ? VK_TRUE : VK_FALSE;
+
+		std::vector<const char*> enabledExtensions = getDeviceExtensions();
+		bool drawIndirectCountSupported = isDeviceExtensionSupported(physicalDevice, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		if (drawIndirectCountSupported) {
+			enabledExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		}
+
+		pipelineCreationFeedbackSupported = isDeviceExtensionSupported(physicalDevice, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+		if (pipelineCreationFeedbackSupported) {
+			enabledExtensions.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+		}
+
+		VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = BindlessTextures::GetRequiredFeatures();
 
 		VkDeviceCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		createInfo.pNext = &indexingFeatures;
 
 		createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 		createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
 		createInfo.pEnabledFeatures = &deviceFeatures;
 
-		createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-		createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+		createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
 		if (enableValidationLayers) {
 			createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -507,11 +895,60 @@ private:
 			throw std::runtime_error("failed to create logical device!");
 		}
 
+		if (drawIndirectCountSupported) {
+			cmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+		}
+
 		vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+
+		if (indices.transferFamily.has_value()) {
+			vkGetDeviceQueue(device, indices.transferFamily.value(), 0, &transferQueue);
+		}
+		else {
+			transferQueue = graphicsQueue;
+		}
+	}
+
+	void createMemoryAllocator() {
+		PROFILE_FUNCTION();
+		memoryAllocator.Initialize(physicalDevice, device);
+	}
+
+	void mountAssets() {
+		PROFILE_FUNCTION();
+		if (!std::ifstream(archivePath).good()) {
+			return;
+		}
+
+		assetReader.Mount(archivePath);
+		if (enableValidationLayers) {
+			std::cout << "Assets: mounted " << archivePath << std::endl;
+		}
+	}
+
+	void createPipelineCache() {
+		PROFILE_FUNCTION();
+		pipelineCache.Create(physicalDevice, device, PIPELINE_CACHE_PATH, pipelineCreationFeedbackSupported);
+	}
+
+	void createDescriptorAllocator() {
+		PROFILE_FUNCTION();
+		std::vector<DescriptorPoolSizeRatio> ratios = {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1.0f },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3.0f },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f }
+		};
+		descriptorAllocator.Create(device, MAX_FRAMES_IN_FLIGHT, DESCRIPTOR_SETS_PER_POOL, ratios);
 	}
 
 	void createSwapChain() {
+		PROFILE_FUNCTION();
+		if (headless) {
+			createOffscreenTargets();
+			return;
+		}
+
 		SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
 		VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -550,6 +987,7 @@ private:
 		createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 		createInfo.presentMode = presentMode;
 		createInfo.clipped = VK_TRUE;
+		createInfo.oldSwapchain = swapChain;
 
 		if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapChain) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create swap chain!");
@@ -563,15 +1001,31 @@ private:
 		swapChainExtent = extent;
 	}
 
+	//Headless stand-in for the swapchain images: one color target per frame in flight, readable by transfers.
+	void createOffscreenTargets() {
+		PROFILE_FUNCTION();
+		swapChainImageFormat = HEADLESS_COLOR_FORMAT;
+		swapChainExtent = { static_cast<uint32_t>(WIDTH), static_cast<uint32_t>(HEIGHT) };
+
+		swapChainImages.resize(MAX_FRAMES_IN_FLIGHT);
+		offscreenImageMemory.resize(MAX_FRAMES_IN_FLIGHT);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			createImage(swapChainExtent.width, swapChainExtent.height, 1, swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, swapChainImages[i], offscreenImageMemory[i]);
+		}
+	}
+
 	void createImageViews() {
+		PROFILE_FUNCTION();
 		swapChainImageViews.resize(swapChainImages.size());
 
 		for (uint32_t i = 0; i < swapChainImages.size(); i++) {
-			swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+			swapChainImageViews[i] = createImageView(swapChainImages[i], swapChainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1);
 		}
 	}
 
 	void createRenderPass() {
+		PROFILE_FUNCTION();
 		VkAttachmentDescription colorAttachment = {};
 		colorAttachment.format = swapChainImageFormat;
 		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -580,7 +1034,7 @@ private:
 		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		colorAttachment.finalLayout = headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 		VkAttachmentDescription depthAttachment = {};
 		depthAttachment.format = findDepthFormat();
@@ -630,21 +1084,15 @@ private:
 	}
 
 	void createDescriptorSetLayout() {
+		PROFILE_FUNCTION();
 		VkDescriptorSetLayoutBinding uboLayoutBinding = {};
 		uboLayoutBinding.binding = 0;
 		uboLayoutBinding.descriptorCount = 1;
-		uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
 		uboLayoutBinding.pImmutableSamplers = nullptr;
 		uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 
-		VkDescriptorSetLayoutBinding samplerLayoutBinding = {};
-		samplerLayoutBinding.binding = 1;
-		samplerLayoutBinding.descriptorCount = 1;
-		samplerLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		samplerLayoutBinding.pImmutableSamplers = nullptr;
-		samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-
-		std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
+		std::array<VkDescriptorSetLayoutBinding, 1> bindings = { uboLayoutBinding };
 		VkDescriptorSetLayoutCreateInfo layoutInfo = {};
 		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 		layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -655,9 +1103,16 @@ private:
 		}
 	}
 
+	//Set 1 of the graphics pipeline: every texture lives in one array and instances select theirs by index.
+	void createBindlessTextures() {
+		PROFILE_FUNCTION();
+		bindlessTextures.Create(physicalDevice, device, MAX_BINDLESS_TEXTURES);
+	}
+
 	void createGraphicsPipeline() {
-		auto vertShaderCode = readFile("vert.spv");
-		auto fragShaderCode = readFile("frag.spv");
+		PROFILE_FUNCTION();
+		AssetView vertShaderCode = assetReader.Read("vert.spv");
+		AssetView fragShaderCode = assetReader.Read("frag.spv");
 
 		VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
 		VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
@@ -676,11 +1131,11 @@ private:
 
 		VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-		auto bindingDescription = Vertex::getBindingDescription();
+		auto bindingDescriptions = Vertex::getBindingDescriptions();
 		auto attributeDescriptions = Vertex::getAttributeDescriptions();
 
 		VertexBuffer vBuffer;
-		VkPipelineVertexInputStateCreateInfo VertexInputInfo = vBuffer.SetUpVertexBuffer(bindingDescription, attributeDescriptions);
+		VkPipelineVertexInputStateCreateInfo VertexInputInfo = vBuffer.SetUpVertexBuffer(bindingDescriptions, attributeDescriptions);
 
 
 		VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
@@ -688,24 +1143,17 @@ private:
 		inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 		inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-		VkViewport viewport = {};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = (float)swapChainExtent.width;
-		viewport.height = (float)swapChainExtent.height;
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-
-		VkRect2D scissor = {};
-		scissor.offset = { 0, 0 };
-		scissor.extent = swapChainExtent;
-
 		VkPipelineViewportStateCreateInfo viewportState = {};
 		viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 		viewportState.viewportCount = 1;
-		viewportState.pViewports = &viewport;
 		viewportState.scissorCount = 1;
-		viewportState.pScissors = &scissor;
+
+		std::array<VkDynamicState, 2> dynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		VkPipelineDynamicStateCreateInfo dynamicState = {};
+		dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+		dynamicState.pDynamicStates = dynamicStates.data();
 
 		VkPipelineRasterizationStateCreateInfo rasterizer = {};
 		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -747,8 +1195,9 @@ private:
 
 		VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = 1;
-		pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+		std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayout, bindlessTextures.GetLayout() };
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = setLayouts.data();
 
 		if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create pipeline layout!");
@@ -756,6 +1205,7 @@ private:
 
 		VkGraphicsPipelineCreateInfo pipelineInfo = {};
 		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.pNext = pipelineCache.BeginCreate(2);
 		pipelineInfo.stageCount = 2;
 		pipelineInfo.pStages = shaderStages;
 		pipelineInfo.pVertexInputState = &VertexInputInfo;
@@ -765,20 +1215,23 @@ private:
 		pipelineInfo.pMultisampleState = &multisampling;
 		pipelineInfo.pDepthStencilState = &depthStencil;
 		pipelineInfo.pColorBlendState = &colorBlending;
+		pipelineInfo.pDynamicState = &dynamicState;
 		pipelineInfo.layout = pipelineLayout;
 		pipelineInfo.renderPass = renderPass;
 		pipelineInfo.subpass = 0;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-		if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+		if (vkCreateGraphicsPipelines(device, pipelineCache.GetCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create graphics pipeline!");
 		}
+		pipelineCache.EndCreate("graphics pipeline");
 
 		vkDestroyShaderModule(device, fragShaderModule, nullptr);
 		vkDestroyShaderModule(device, vertShaderModule, nullptr);
 	}
 
 	void createFramebuffers() {
+		PROFILE_FUNCTION();
 		swapChainFramebuffers.resize(swapChainImageViews.size());
 
 		for (size_t i = 0; i < swapChainImageViews.size(); i++) {
@@ -803,22 +1256,74 @@ private:
 	}
 
 	void createCommandPool() {
+		PROFILE_FUNCTION();
 		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
 		VkCommandPoolCreateInfo poolInfo = {};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 		poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
 
-		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create graphics command pool!");
+		commandPools.resize(MAX_FRAMES_IN_FLIGHT);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPools[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create graphics command pool!");
+			}
 		}
 	}
 
+	void createCommandRecorder() {
+		PROFILE_FUNCTION();
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+		uint32_t threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_RECORDING_THREADS);
+		commandRecorder.Create(device, queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, threadCount);
+	}
+
+	void createGpuProfiling() {
+		PROFILE_FUNCTION();
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+		//The cull dispatch, the render pass and one scope per secondary buffer.
+		uint32_t scopeCount = 2 + commandRecorder.GetThreadCount();
+		gpuTimer.Create(physicalDevice, device, queueFamilyIndices.graphicsFamily.value(), MAX_FRAMES_IN_FLIGHT, scopeCount);
+
+		if (pipelineStatisticsRequested && !pipelineStatisticsSupported) {
+			std::cerr << "Pipeline statistics queries are not supported by this device" << std::endl;
+		}
+		//One query per secondary buffer, since a query has to begin and end in the same command buffer.
+		pipelineStatistics.Create(device, pipelineStatisticsRequested && pipelineStatisticsSupported, MAX_FRAMES_IN_FLIGHT, commandRecorder.GetThreadCount());
+	}
+
+	void createUploadContext() {
+		PROFILE_FUNCTION();
+		QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+		uint32_t graphicsFamily = queueFamilyIndices.graphicsFamily.value();
+
+		uploadContext.Initialize(device, transferQueue, queueFamilyIndices.transferFamily.value_or(graphicsFamily), graphicsQueue, graphicsFamily);
+	}
+
+	void createStagingBufferPool() {
+		PROFILE_FUNCTION();
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		VkDeviceSize alignment = std::max<VkDeviceSize>(properties.limits.optimalBufferCopyOffsetAlignment, 16);
+		stagingBufferPool.Create(memoryAllocator, device, uploadContext, STAGING_BUFFER_BUDGET, alignment);
+	}
+
+	void submitUploads() {
+		PROFILE_FUNCTION();
+		uploadContext.Submit();
+	}
+
 	void createDepthResources() {
+		PROFILE_FUNCTION();
 		VkFormat depthFormat = findDepthFormat();
 
-		createImage(swapChainExtent.width, swapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
-		depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+		createImage(swapChainExtent.width, swapChainExtent.height, 1, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
+		depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 	}
 
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
@@ -849,41 +1354,8 @@ private:
 		return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
 	}
 
-	void createTextureImage() {
-		int texWidth, texHeight, texChannels;
-		stbi_uc* pixels = stbi_load("C:/Users/ZZT/source/repos/VulkanTest/VulcanTest/texture/texture.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-		VkDeviceSize imageSize = texWidth * texHeight * 4;
-
-		if (!pixels) {
-			throw std::runtime_error("failed to load texture image!");
-		}
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-		memcpy(data, pixels, static_cast<size_t>(imageSize));
-		vkUnmapMemory(device, stagingBufferMemory);
-
-		stbi_image_free(pixels);
-
-		createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-
-		transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-		copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-		transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
-	}
-
-	void createTextureImageView() {
-		textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
-	}
-
 	void createTextureSampler() {
+		PROFILE_FUNCTION();
 		VkSamplerCreateInfo samplerInfo = {};
 		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 		samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -898,13 +1370,24 @@ private:
 		samplerInfo.compareEnable = VK_FALSE;
 		samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
 		samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+		samplerInfo.mipLodBias = 0.0f;
+		samplerInfo.minLod = 0.0f;
+		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 
 		if (vkCreateSampler(device, &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
 			throw std::runtime_error("failed to create texture sampler!");
 		}
 	}
 
-	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags) {
+	//Decoding runs on worker threads; the instances sample a placeholder until the first levels are resident.
+	void createTextureStreamer() {
+		PROFILE_FUNCTION();
+		uint32_t threadCount = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_RECORDING_THREADS);
+		textureStreamer.Create(physicalDevice, device, memoryAllocator, stagingBufferPool, uploadContext, bindlessTextures, assetReader, textureSampler, threadCount, TEXTURE_UPLOAD_BUDGET);
+		textureHandle = textureStreamer.Request(texturePath);
+	}
+
+	VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
 		VkImageViewCreateInfo viewInfo = {};
 		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 		viewInfo.image = image;
@@ -912,7 +1395,7 @@ private:
 		viewInfo.format = format;
 		viewInfo.subresourceRange.aspectMask = aspectFlags;
 		viewInfo.subresourceRange.baseMipLevel = 0;
-		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.levelCount = mipLevels;
 		viewInfo.subresourceRange.baseArrayLayer = 0;
 		viewInfo.subresourceRange.layerCount = 1;
 
@@ -924,14 +1407,15 @@ private:
 		return imageView;
 	}
 
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+	void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocation& imageMemory) {
+		PROFILE_FUNCTION();
 		VkImageCreateInfo imageInfo = {};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageInfo.imageType = VK_IMAGE_TYPE_2D;
 		imageInfo.extent.width = width;
 		imageInfo.extent.height = height;
 		imageInfo.extent.depth = 1;
-		imageInfo.mipLevels = 1;
+		imageInfo.mipLevels = mipLevels;
 		imageInfo.arrayLayers = 1;
 		imageInfo.format = format;
 		imageInfo.tiling = tiling;
@@ -944,348 +1428,287 @@ private:
 			throw std::runtime_error("failed to create image!");
 		}
 
-		VkMemoryRequirements memRequirements;
-		vkGetImageMemoryRequirements(device, image, &memRequirements);
-
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate image memory!");
-		}
-
-		vkBindImageMemory(device, image, imageMemory, 0);
+		imageMemory = memoryAllocator.AllocateImageMemory(image, tiling, properties);
 	}
 
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-		VkImageMemoryBarrier barrier = {};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = oldLayout;
-		barrier.newLayout = newLayout;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = image;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-
-		VkPipelineStageFlags sourceStage;
-		VkPipelineStageFlags destinationStage;
-
-		if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		}
-		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	void loadModel() {
+		PROFILE_FUNCTION();
+		//Without a model on the command line the built-in quads go through the same optimization path.
+		if (modelPath.empty()) {
+			mesh = MeshLoader::FromGeometry(vertices, indices, subsets);
 		}
 		else {
-			throw std::invalid_argument("unsupported layout transition!");
+			mesh = MeshLoader::LoadObj(assetReader.Read(modelPath));
 		}
 
-		vkCmdPipelineBarrier(
-			commandBuffer,
-			sourceStage, destinationStage,
-			0,
-			0, nullptr,
-			0, nullptr,
-			1, &barrier
-		);
-
-		endSingleTimeCommands(commandBuffer);
-	}
-
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-		VkBufferImageCopy region = {};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = 1;
-		region.imageOffset = { 0, 0, 0 };
-		region.imageExtent = {
-			width,
-			height,
-			1
-		};
-
-		vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-		endSingleTimeCommands(commandBuffer);
+		if (enableValidationLayers) {
+			std::cout << "Mesh: " << mesh.Vertices.size() << " vertices, " << mesh.Indices.size() / 3 << " triangles, "
+				<< (mesh.IndexType == VK_INDEX_TYPE_UINT16 ? "16" : "32") << "-bit indices, ACMR "
+				<< MeshLoader::ComputeACMR(mesh.Indices, mesh.Vertices.size(), MeshLoader::VertexCacheSize) << std::endl;
+		}
 	}
 
 	void createVertexBuffer() {
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		BufferManager::CreateBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+		PROFILE_FUNCTION();
+		VkDeviceSize bufferSize = sizeof(mesh.Vertices[0]) * mesh.Vertices.size();
 
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), (size_t)bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
+		StagingAllocation staging = stagingBufferPool.Allocate(bufferSize);
+		memcpy(staging.MappedData, mesh.Vertices.data(), (size_t)bufferSize);
 
-		BufferManager::CreateBuffer(physicalDevice, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
+		BufferManager::CreateBuffer(memoryAllocator, device, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory);
 
-		BufferManager::CopyBuffer(device, commandPool, graphicsQueue, physicalDevice, stagingBuffer, vertexBuffer, bufferSize);
-
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+		BufferManager::CopyBuffer(uploadContext, staging.Buffer, vertexBuffer, bufferSize, staging.Offset);
+		uploadContext.TransferBufferOwnership(vertexBuffer, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 	}
 
 	void createIndexBuffer() {
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+		PROFILE_FUNCTION();
+		VkDeviceSize bufferSize = mesh.GetIndexBufferSize();
 
-		void* data;
-		vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), (size_t)bufferSize);
-		vkUnmapMemory(device, stagingBufferMemory);
+		StagingAllocation staging = stagingBufferPool.Allocate(bufferSize);
+		mesh.WriteIndices(staging.MappedData);
 
 		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory);
 
-		copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-		vkDestroyBuffer(device, stagingBuffer, nullptr);
-		vkFreeMemory(device, stagingBufferMemory, nullptr);
+		BufferManager::CopyBuffer(uploadContext, staging.Buffer, indexBuffer, bufferSize, staging.Offset);
+		uploadContext.TransferBufferOwnership(indexBuffer, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 	}
 
-	void createUniformBuffers() {
-		VkDeviceSize bufferSize = sizeof(UniformBufferObject);
+	void createInstanceBuffer() {
+		PROFILE_FUNCTION();
+		instanceCount = INSTANCE_COUNT;
+		VkDeviceSize bufferSize = sizeof(InstanceData) * instanceCount;
 
-		uniformBuffers.resize(swapChainImages.size());
-		uniformBuffersMemory.resize(swapChainImages.size());
+		StagingAllocation staging = stagingBufferPool.Allocate(bufferSize);
+		InstanceData* instances = static_cast<InstanceData*>(staging.MappedData);
 
-		for (size_t i = 0; i < swapChainImages.size(); i++) {
-			createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffers[i], uniformBuffersMemory[i]);
+		//Lay the copies out on a square grid in the XY plane, scaled so the whole grid stays inside the original quad.
+		uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(instanceCount))));
+		float spacing = 2.0f / gridSize;
+		for (uint32_t i = 0; i < instanceCount; i++) {
+			glm::vec3 position(-1.0f + spacing * (i % gridSize + 0.5f), -1.0f + spacing * (i / gridSize + 0.5f), 0.0f);
+			instances[i].model = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(spacing * 0.8f));
+			instances[i].textureIndex = textureHandle;
+			instanceTransforms.push_back(instances[i].model);
 		}
-	}
 
-	void createDescriptorPool() {
-		std::array<VkDescriptorPoolSize, 2> poolSizes = {};
-		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes[0].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
-		poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		poolSizes[1].descriptorCount = static_cast<uint32_t>(swapChainImages.size());
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, instanceBuffer, instanceBufferMemory);
 
-		VkDescriptorPoolCreateInfo poolInfo = {};
-		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-		poolInfo.pPoolSizes = poolSizes.data();
-		poolInfo.maxSets = static_cast<uint32_t>(swapChainImages.size());
+		BufferManager::CopyBuffer(uploadContext, staging.Buffer, instanceBuffer, bufferSize, staging.Offset);
+		uploadContext.TransferBufferOwnership(instanceBuffer, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+	}
 
-		if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create descriptor pool!");
+	void createFrustumCuller() {
+		PROFILE_FUNCTION();
+		glm::vec3 boundsMin = mesh.Vertices[0].pos;
+		glm::vec3 boundsMax = mesh.Vertices[0].pos;
+		for (const auto& vertex : mesh.Vertices) {
+			boundsMin = glm::min(boundsMin, vertex.pos);
+			boundsMax = glm::max(boundsMax, vertex.pos);
 		}
-	}
 
-	void createDescriptorSets() {
-		std::vector<VkDescriptorSetLayout> layouts(swapChainImages.size(), descriptorSetLayout);
-		VkDescriptorSetAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-		allocInfo.descriptorPool = descriptorPool;
-		allocInfo.descriptorSetCount = static_cast<uint32_t>(swapChainImages.size());
-		allocInfo.pSetLayouts = layouts.data();
+		glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+		float radius = 0.0f;
+		for (const auto& vertex : mesh.Vertices) {
+			radius = std::max(radius, glm::length(vertex.pos - center));
+		}
+		meshBounds = { center.x, center.y, center.z, radius };
 
-		descriptorSets.resize(swapChainImages.size());
-		if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate descriptor sets!");
+		std::vector<VkDrawIndexedIndirectCommand> indirectDraws;
+		for (const auto& subset : mesh.Subsets) {
+			indirectDraws.push_back({ subset.IndexCount, 0, subset.FirstIndex, 0, 0 });
 		}
 
-		for (size_t i = 0; i < swapChainImages.size(); i++) {
-			VkDescriptorBufferInfo bufferInfo = {};
-			bufferInfo.buffer = uniformBuffers[i];
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(UniformBufferObject);
+		AssetView cullShaderCode = assetReader.Read("cull.spv");
+		frustumCuller.Create(memoryAllocator, device, pipelineCache, descriptorAllocator, cullShaderCode, instanceBuffer, sizeof(InstanceData), instanceCount,
+			textureStreamer.GetSlotTableBuffer(), indirectDraws, MAX_FRAMES_IN_FLIGHT);
+	}
 
-			VkDescriptorImageInfo imageInfo = {};
-			imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			imageInfo.imageView = textureImageView;
-			imageInfo.sampler = textureSampler;
+	void createUniformBuffers() {
+		PROFILE_FUNCTION();
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
 
-			std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+		VkDeviceSize alignment = properties.limits.minUniformBufferOffsetAlignment;
+		VkDeviceSize sliceSize = (sizeof(UniformBufferObject) + alignment - 1) & ~(alignment - 1);
 
-			descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[0].dstSet = descriptorSets[i];
-			descriptorWrites[0].dstBinding = 0;
-			descriptorWrites[0].dstArrayElement = 0;
-			descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			descriptorWrites[0].descriptorCount = 1;
-			descriptorWrites[0].pBufferInfo = &bufferInfo;
+		uniformRingBuffer.Create(memoryAllocator, device, alignment, sliceSize * MAX_UNIFORM_OBJECTS_PER_FRAME, MAX_FRAMES_IN_FLIGHT);
+	}
 
-			descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			descriptorWrites[1].dstSet = descriptorSets[i];
-			descriptorWrites[1].dstBinding = 1;
-			descriptorWrites[1].dstArrayElement = 0;
-			descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorWrites[1].descriptorCount = 1;
-			descriptorWrites[1].pImageInfo = &imageInfo;
+	void createDescriptorSets() {
+		PROFILE_FUNCTION();
+		//The dynamic offset picks the frame's slice of the ring, so one set serves every frame in flight.
+		DescriptorSetKey uniformKey;
+		uniformKey.Layout = descriptorSetLayout;
+		uniformKey.AddBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, uniformRingBuffer.GetBuffer(), 0, sizeof(UniformBufferObject));
+		uniformDescriptorSet = descriptorAllocator.GetCachedSet(uniformKey);
 
-			vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
-		}
+		frustumCuller.SetUniformBuffer(uniformRingBuffer.GetBuffer(), sizeof(UniformBufferObject));
 	}
 
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
-		VkBufferCreateInfo bufferInfo = {};
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = size;
-		bufferInfo.usage = usage;
-		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocation& bufferMemory) {
+		PROFILE_FUNCTION();
+		BufferManager::CreateBuffer(memoryAllocator, device, size, usage, properties, buffer, bufferMemory);
+	}
 
-		if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create buffer!");
-		}
+	void createCommandBuffers() {
+		PROFILE_FUNCTION();
+		commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+		for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = commandPools[i];
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffers[i]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to allocate command buffers!");
+			}
+		}
+	}
 
-		VkMemoryAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+	void recordCommandBuffer(uint32_t imageIndex) {
+		PROFILE_FUNCTION();
+		auto recordStart = std::chrono::high_resolution_clock::now();
 
-		if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate buffer memory!");
+		if (vkResetCommandPool(device, commandPools[currentFrame], 0) != VK_SUCCESS) {
+			throw std::runtime_error("failed to reset graphics command pool!");
 		}
 
-		vkBindBufferMemory(device, buffer, bufferMemory, 0);
-	}
+		VkCommandBuffer commandBuffer = commandBuffers[currentFrame];
 
-	VkCommandBuffer beginSingleTimeCommands() {
-		VkCommandBufferAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = commandPool;
-		allocInfo.commandBufferCount = 1;
+		VkCommandBufferInheritanceInfo inheritanceInfo = {};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = swapChainFramebuffers[imageIndex];
 
-		VkCommandBuffer commandBuffer;
-		vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+		uint32_t frame = static_cast<uint32_t>(currentFrame);
 
 		VkCommandBufferBeginInfo beginInfo = {};
 		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-		return commandBuffer;
-	}
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("failed to begin recording command buffer!");
+		}
 
-	void endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-		vkEndCommandBuffer(commandBuffer);
+		//Scopes are reserved here so the recording threads only write timestamps.
+		gpuTimer.Reset(commandBuffer, frame);
+		pipelineStatistics.Reset(commandBuffer, frame);
+		uint32_t cullScope = gpuTimer.AddScope(frame, "cull");
+		uint32_t renderPassScope = gpuTimer.AddScope(frame, "render pass");
 
-		VkSubmitInfo submitInfo = {};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
+		uint32_t drawItemCount = static_cast<uint32_t>(mesh.Subsets.size());
+		uint32_t drawGroupCount = commandRecorder.GetSliceCount(drawItemCount);
+		drawGroupScopes.resize(drawGroupCount);
+		for (uint32_t i = 0; i < drawGroupCount; i++) {
+			drawGroupScopes[i] = gpuTimer.AddScope(frame, "draw group " + std::to_string(i));
+		}
+		drawGroupQueries.resize(drawGroupCount);
+		for (uint32_t i = 0; i < drawGroupCount; i++) {
+			drawGroupQueries[i] = pipelineStatistics.AddQuery(frame);
+		}
 
-		vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(graphicsQueue);
+		const std::vector<VkCommandBuffer>& secondaryBuffers = commandRecorder.Record(frame, inheritanceInfo, drawItemCount,
+			[this, frame, drawItemCount, drawGroupCount](VkCommandBuffer secondary, uint32_t firstItem, uint32_t itemCount) {
+				uint32_t group = 0;
+				while (group + 1 < drawGroupCount && CommandRecorder::GetSliceFirstItem(drawItemCount, drawGroupCount, group + 1) <= firstItem) {
+					group++;
+				}
+				gpuTimer.WriteBegin(secondary, frame, drawGroupScopes[group]);
+				pipelineStatistics.Begin(secondary, frame, drawGroupQueries[group]);
 
-		vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-	}
+				vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+				//Dynamic state is not inherited by secondaries, so every one sets the current extent itself.
+				VkViewport viewport = {};
+				viewport.x = 0.0f;
+				viewport.y = 0.0f;
+				viewport.width = (float)swapChainExtent.width;
+				viewport.height = (float)swapChainExtent.height;
+				viewport.minDepth = 0.0f;
+				viewport.maxDepth = 1.0f;
+				vkCmdSetViewport(secondary, 0, 1, &viewport);
 
-		VkBufferCopy copyRegion = {};
-		copyRegion.size = size;
-		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+				VkRect2D scissor = {};
+				scissor.offset = { 0, 0 };
+				scissor.extent = swapChainExtent;
+				vkCmdSetScissor(secondary, 0, 1, &scissor);
 
-		endSingleTimeCommands(commandBuffer);
-	}
+				VkBuffer vertexBuffers[] = { vertexBuffer, frustumCuller.GetVisibleInstanceBuffer(frame) };
+				VkDeviceSize offsets[] = { 0, 0 };
+				vkCmdBindVertexBuffers(secondary, 0, 2, vertexBuffers, offsets);
 
-	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+				vkCmdBindIndexBuffer(secondary, indexBuffer, 0, mesh.IndexType);
 
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
-			}
-		}
+				uint32_t dynamicOffset = uniformRingBuffer.GetFrameOffset(frame);
+				vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &uniformDescriptorSet, 1, &dynamicOffset);
 
-		throw std::runtime_error("failed to find suitable memory type!");
-	}
+				VkDescriptorSet textureSet = bindlessTextures.GetDescriptorSet();
+				vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1, &textureSet, 0, nullptr);
 
-	void createCommandBuffers() {
-		commandBuffers.resize(swapChainFramebuffers.size());
+				//The culling pass writes a draw count of either zero or every draw item, so clamping it to this slice is exact.
+				VkBuffer indirectBuffer = frustumCuller.GetIndirectBuffer(frame);
+				VkDeviceSize commandOffset = frustumCuller.GetCommandOffset() + firstItem * sizeof(VkDrawIndexedIndirectCommand);
+				uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
 
-		VkCommandBufferAllocateInfo allocInfo = {};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.commandPool = commandPool;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
-
-		if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate command buffers!");
-		}
-
-		for (size_t i = 0; i < commandBuffers.size(); i++) {
-			VkCommandBufferBeginInfo beginInfo = {};
-			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-			if (vkBeginCommandBuffer(commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-				throw std::runtime_error("failed to begin recording command buffer!");
-			}
-
-			VkRenderPassBeginInfo renderPassInfo = {};
-			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-			renderPassInfo.renderPass = renderPass;
-			renderPassInfo.framebuffer = swapChainFramebuffers[i];
-			renderPassInfo.renderArea.offset = { 0, 0 };
-			renderPassInfo.renderArea.extent = swapChainExtent;
-
-			std::array<VkClearValue, 2> clearValues = {};
-			clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-			clearValues[1].depthStencil = { 1.0f, 0 };
+				if (cmdDrawIndexedIndirectCount != nullptr) {
+					cmdDrawIndexedIndirectCount(secondary, indirectBuffer, commandOffset, indirectBuffer, frustumCuller.GetDrawCountOffset(), itemCount, stride);
+				}
+				else if (multiDrawIndirectSupported) {
+					vkCmdDrawIndexedIndirect(secondary, indirectBuffer, commandOffset, itemCount, stride);
+				}
+				else {
+					for (uint32_t i = 0; i < itemCount; i++) {
+						vkCmdDrawIndexedIndirect(secondary, indirectBuffer, commandOffset + i * stride, 1, stride);
+					}
+				}
 
-			renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-			renderPassInfo.pClearValues = clearValues.data();
+				pipelineStatistics.End(secondary, frame, drawGroupQueries[group]);
+				gpuTimer.WriteEnd(secondary, frame, drawGroupScopes[group]);
+			});
 
-			vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		gpuTimer.WriteBegin(commandBuffer, frame, cullScope);
+		updateTextureSlotTable(commandBuffer);
+		frustumCuller.RecordCull(commandBuffer, frame, uniformRingBuffer.GetFrameOffset(frame), meshBounds);
+		gpuTimer.WriteEnd(commandBuffer, frame, cullScope);
 
-			vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+		VkRenderPassBeginInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		renderPassInfo.renderPass = renderPass;
+		renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+		renderPassInfo.renderArea.offset = { 0, 0 };
+		renderPassInfo.renderArea.extent = swapChainExtent;
 
-			VkBuffer vertexBuffers[] = { vertexBuffer };
-			VkDeviceSize offsets[] = { 0 };
-			vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets);
+		std::array<VkClearValue, 2> clearValues = {};
+		clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+		clearValues[1].depthStencil = { 1.0f, 0 };
 
-			vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+		renderPassInfo.pClearValues = clearValues.data();
 
-			vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i], 0, nullptr);
+		gpuTimer.WriteBegin(commandBuffer, frame, renderPassScope);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
-			vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+		if (!secondaryBuffers.empty()) {
+			vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryBuffers.size()), secondaryBuffers.data());
+		}
 
-			vkCmdEndRenderPass(commandBuffers[i]);
+		vkCmdEndRenderPass(commandBuffer);
+		gpuTimer.WriteEnd(commandBuffer, frame, renderPassScope);
 
-			if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS) {
-				throw std::runtime_error("failed to record command buffer!");
-			}
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to record command buffer!");
 		}
+
+		recordingTime += std::chrono::high_resolution_clock::now() - recordStart;
+		recordedFrameCount++;
 	}
 
 	void createSyncObjects() {
+		PROFILE_FUNCTION();
 		imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
 		inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
@@ -1307,31 +1730,113 @@ private:
 		}
 	}
 
-	void updateUniformBuffer(uint32_t currentImage) {
+	//Projected diameter in pixels of the closest instance, which is the largest the texture appears this frame.
+	float estimateTextureScreenSize() {
+		glm::vec3 meshCenter(meshBounds.X, meshBounds.Y, meshBounds.Z);
+		float focalLength = swapChainExtent.height * 0.5f / std::tan(glm::radians(CAMERA_FOV_DEGREES) * 0.5f);
+
+		float size = 0.0f;
+		for (const auto& transform : instanceTransforms) {
+			glm::mat4 model = sceneTransform * transform;
+			glm::vec3 center = glm::vec3(model * glm::vec4(meshCenter, 1.0f));
+			float radius = meshBounds.Radius * glm::length(glm::vec3(model[0]));
+			float distance = std::max(glm::length(center - CAMERA_POSITION) - radius, 0.1f);
+			size = std::max(size, 2.0f * radius * focalLength / distance);
+		}
+		return size;
+	}
+
+	//The streamer hands out a new bindless slot whenever more levels become resident. Only that texture's slot table entry
+	//is rewritten, ahead of the cull pass that resolves every instance's handle through the table.
+	void updateTextureSlotTable(VkCommandBuffer commandBuffer) {
+		if (textureStreamer.RecordSlotTableUpdate(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) && enableValidationLayers) {
+			std::cout << "Texture: level " << textureStreamer.GetResidentLevel(textureHandle) << " resident, " << textureStreamer.GetBytesUploaded() << " bytes streamed" << std::endl;
+		}
+	}
+
+	void updateUniformBuffer(uint32_t frame) {
+		PROFILE_FUNCTION();
 		static auto startTime = std::chrono::high_resolution_clock::now();
 
 		auto currentTime = std::chrono::high_resolution_clock::now();
 		float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+		if (headless) {
+			time = animationFrame * HEADLESS_FRAME_TIME;
+		}
 
 		UniformBufferObject ubo = {};
 		ubo.model = glm::rotate(glm::mat4(1.0f), time * glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-		ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-		ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
+		ubo.view = glm::lookAt(CAMERA_POSITION, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		ubo.proj = glm::perspective(glm::radians(CAMERA_FOV_DEGREES), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 10.0f);
 		ubo.proj[1][1] *= -1;
+		sceneTransform = ubo.model;
+
+		uniformRingBuffer.BeginFrame(frame);
+		uniformRingBuffer.Push(ubo);
+	}
+
+	//The timings read here are from this frame slot's previous submission, MAX_FRAMES_IN_FLIGHT frames ago.
+	void collectGpuTimings() {
+		if (!gpuTimer.Collect(static_cast<uint32_t>(currentFrame))) {
+			return;
+		}
+
+		for (const GpuTiming& timing : gpuTimer.GetResults()) {
+			frameBenchmark.AddSample("gpu " + timing.Name, timing.Milliseconds);
+		}
+	}
+
+	void collectPipelineStatistics() {
+		if (!pipelineStatistics.Collect(static_cast<uint32_t>(currentFrame))) {
+			return;
+		}
 
-		void* data;
-		vkMapMemory(device, uniformBuffersMemory[currentImage], 0, sizeof(ubo), 0, &data);
-		memcpy(data, &ubo, sizeof(ubo));
-		vkUnmapMemory(device, uniformBuffersMemory[currentImage]);
+		const DrawStatistics& statistics = pipelineStatistics.GetFrameStatistics();
+		frameBenchmark.AddSample("vertex invocations", static_cast<double>(statistics.VertexInvocations));
+		frameBenchmark.AddSample("clipping primitives", static_cast<double>(statistics.ClippingPrimitives));
+		frameBenchmark.AddSample("fragment invocations", static_cast<double>(statistics.FragmentInvocations));
+		frameBenchmark.AddSample("vertices per triangle", statistics.VerticesPerTriangle());
+		frameBenchmark.AddSample("overdraw", statistics.Overdraw(static_cast<uint64_t>(swapChainExtent.width) * swapChainExtent.height));
 	}
 
 	void drawFrame() {
-		vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+		PROFILE_FUNCTION();
+		frameBenchmark.BeginFrame();
+		{
+			PROFILE_SCOPE("wait for frame fence");
+			vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+		}
+		frameBenchmark.Mark(FrameBenchmark::FenceWait);
+
+		//This frame's fence was last signalled by submission (submittedFrameCount - MAX_FRAMES_IN_FLIGHT + 1), and everything
+		//before it on the queue has finished too.
+		uint64_t completedFrameCount = submittedFrameCount >= MAX_FRAMES_IN_FLIGHT - 1 ? submittedFrameCount - (MAX_FRAMES_IN_FLIGHT - 1) : 0;
+		{
+			PROFILE_SCOPE("housekeeping");
+			destroyRetiredSwapChains(completedFrameCount);
+			bindlessTextures.Collect(completedFrameCount);
+			descriptorAllocator.ResetFrame(static_cast<uint32_t>(currentFrame));
+
+			uploadContext.Collect();
+			collectGpuTimings();
+			collectPipelineStatistics();
+		}
+		frameBenchmark.Mark(FrameBenchmark::Housekeeping);
 
 		uint32_t imageIndex;
-		VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		VkResult result = VK_SUCCESS;
+		if (headless) {
+			//Each frame in flight has its own offscreen target, already protected by the frame's fence.
+			imageIndex = static_cast<uint32_t>(currentFrame);
+		}
+		else {
+			PROFILE_SCOPE("acquire");
+			result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+		}
+		frameBenchmark.Mark(FrameBenchmark::Acquire);
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+			frameBenchmark.CancelFrame();
 			recreateSwapChain();
 			return;
 		}
@@ -1339,33 +1844,54 @@ private:
 			throw std::runtime_error("failed to acquire swap chain image!");
 		}
 
-		updateUniformBuffer(imageIndex);
+		updateUniformBuffer(static_cast<uint32_t>(currentFrame));
+		frameBenchmark.Mark(FrameBenchmark::UniformUpdate);
+
+		textureStreamer.SetScreenSize(textureHandle, estimateTextureScreenSize());
+		textureStreamer.Update(submittedFrameCount + 1, completedFrameCount);
+		frameBenchmark.Mark(FrameBenchmark::TextureStreaming);
 
 		if (imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+			PROFILE_SCOPE("wait for image fence");
 			vkWaitForFences(device, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
 		}
 		imagesInFlight[imageIndex] = inFlightFences[currentFrame];
 
+		recordCommandBuffer(imageIndex);
+		frameBenchmark.Mark(FrameBenchmark::Record);
+
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
 		VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
 		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.waitSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
 
 		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+		submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
 
 		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
-		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 		submitInfo.pSignalSemaphores = signalSemaphores;
 
 		vkResetFences(device, 1, &inFlightFences[currentFrame]);
 
-		if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to submit draw command buffer!");
+		{
+			PROFILE_SCOPE("submit");
+			if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to submit draw command buffer!");
+			}
+		}
+		submittedFrameCount++;
+		lastImageIndex = imageIndex;
+		frameBenchmark.Mark(FrameBenchmark::Submit);
+
+		if (headless) {
+			frameBenchmark.EndFrame();
+			currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+			return;
 		}
 
 		VkPresentInfoKHR presentInfo = {};
@@ -1380,7 +1906,12 @@ private:
 
 		presentInfo.pImageIndices = &imageIndex;
 
-		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+		{
+			PROFILE_SCOPE("present");
+			result = vkQueuePresentKHR(presentQueue, &presentInfo);
+		}
+		frameBenchmark.Mark(FrameBenchmark::Present);
+		frameBenchmark.EndFrame();
 
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
 			framebufferResized = false;
@@ -1393,11 +1924,12 @@ private:
 		currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 	}
 
-	VkShaderModule createShaderModule(const std::vector<char>& code) {
+	//SPIR-V is handed to the driver straight out of the mapping; archive entries and mappings are both suitably aligned.
+	VkShaderModule createShaderModule(const AssetView& code) {
 		VkShaderModuleCreateInfo createInfo = {};
 		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+		createInfo.codeSize = code.Size;
+		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.Data);
 
 		VkShaderModule shaderModule;
 		if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
@@ -1476,8 +2008,8 @@ private:
 
 		bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-		bool swapChainAdequate = false;
-		if (extensionsSupported) {
+		bool swapChainAdequate = headless;
+		if (extensionsSupported && !headless) {
 			SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
 			swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
 		}
@@ -1485,7 +2017,7 @@ private:
 		VkPhysicalDeviceFeatures supportedFeatures;
 		vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+		return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy && BindlessTextures::IsSupported(device);
 	}
 
 	bool checkDeviceExtensionSupport(VkPhysicalDevice device) {
@@ -1495,7 +2027,8 @@ private:
 		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
 		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-		std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+		std::vector<const char*> extensions = getDeviceExtensions();
+		std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
 		for (const auto& extension : availableExtensions) {
 			requiredExtensions.erase(extension.extensionName);
@@ -1504,6 +2037,33 @@ private:
 		return requiredExtensions.empty();
 	}
 
+	//Headless runs never present, so they do not need the swapchain extension.
+	std::vector<const char*> getDeviceExtensions() {
+		std::vector<const char*> extensions;
+		for (const char* extension : deviceExtensions) {
+			if (!headless || strcmp(extension, VK_KHR_SWAPCHAIN_EXTENSION_NAME) != 0) {
+				extensions.push_back(extension);
+			}
+		}
+		return extensions;
+	}
+
+	bool isDeviceExtensionSupported(VkPhysicalDevice device, const char* extensionName) {
+		uint32_t extensionCount;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		for (const auto& extension : availableExtensions) {
+			if (strcmp(extension.extensionName, extensionName) == 0) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device) {
 		QueueFamilyIndices indices;
 
@@ -1515,19 +2075,29 @@ private:
 
 		int i = 0;
 		for (const auto& queueFamily : queueFamilies) {
-			if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-				indices.graphicsFamily = i;
-			}
+			if (!indices.isComplete()) {
+				if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+					indices.graphicsFamily = i;
+				}
 
-			VkBool32 presentSupport = false;
-			vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+				//Without a surface nothing is presented; the graphics family stands in so the queue setup is unchanged.
+				VkBool32 presentSupport = false;
+				if (headless) {
+					presentSupport = indices.graphicsFamily.has_value() && indices.graphicsFamily.value() == static_cast<uint32_t>(i);
+				}
+				else {
+					vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+				}
 
-			if (presentSupport) {
-				indices.presentFamily = i;
+				if (presentSupport) {
+					indices.presentFamily = i;
+				}
 			}
 
-			if (indices.isComplete()) {
-				break;
+			//A transfer-only family is usually backed by the DMA engines, so copies there overlap rendering.
+			if (!indices.transferFamily.has_value() && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+				!(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+				indices.transferFamily = i;
 			}
 
 			i++;
@@ -1537,11 +2107,15 @@ private:
 	}
 
 	std::vector<const char*> getRequiredExtensions() {
-		uint32_t glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		std::vector<const char*> extensions;
 
-		std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		if (!headless) {
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions;
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+			extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		}
 
 		if (enableValidationLayers) {
 			extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -1575,24 +2149,6 @@ private:
 		return true;
 	}
 
-	static std::vector<char> readFile(const std::string& filename) {
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-		if (!file.is_open()) {
-			throw std::runtime_error("failed to open file!");
-		}
-
-		size_t fileSize = (size_t)file.tellg();
-		std::vector<char> buffer(fileSize);
-
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
-
-		file.close();
-
-		return buffer;
-	}
-
 	static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
 		std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
 
@@ -1600,8 +2156,69 @@ private:
 	}
 };
 
-int main() {
+//	VulcanTest [model.obj [texture [assets.pak]]] [--headless] [--frames N] [--output image.png]
+//		[--benchmark results.json] [--warmup-frames N] [--benchmark-frames N] [--baseline previous.json] [--pipeline-statistics]
+//		[--trace trace.json]
+//--frames and --output imply --headless. A benchmark fails the run when the frame time regressed against the baseline.
+//--trace writes the CPU profiling zones as a Chrome trace; release builds need VULCANTEST_PROFILING defined.
+int main(int argc, char* argv[]) {
 	HelloTriangleApplication app;
+	std::vector<std::string> positional;
+	for (int i = 1; i < argc; i++) {
+		std::string argument = argv[i];
+		if (argument == "--headless") {
+			app.headless = true;
+		}
+		else if (argument == "--frames" && i + 1 < argc) {
+			app.headless = true;
+			app.headlessFrameCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (argument == "--output" && i + 1 < argc) {
+			app.headless = true;
+			app.outputPath = argv[++i];
+		}
+		else if (argument == "--benchmark" && i + 1 < argc) {
+			app.benchmarkPath = argv[++i];
+		}
+		else if (argument == "--warmup-frames" && i + 1 < argc) {
+			app.benchmarkWarmUpFrames = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (argument == "--benchmark-frames" && i + 1 < argc) {
+			app.benchmarkFrameCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+		}
+		else if (argument == "--baseline" && i + 1 < argc) {
+			app.baselinePath = argv[++i];
+		}
+		else if (argument == "--pipeline-statistics") {
+			app.pipelineStatisticsRequested = true;
+		}
+		else if (argument == "--trace" && i + 1 < argc) {
+			app.tracePath = argv[++i];
+		}
+		else if (argument.rfind("--", 0) == 0) {
+			//Also catches a valued option given last without its value.
+			std::cerr << "unknown option or missing value: " << argument << std::endl;
+			return EXIT_FAILURE;
+		}
+		else {
+			positional.push_back(argument);
+		}
+	}
+
+	if (positional.size() > 3) {
+		std::cerr << "unexpected argument " << positional[3] << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (positional.size() > 0) {
+		app.modelPath = positional[0];
+	}
+	if (positional.size() > 1) {
+		app.texturePath = positional[1];
+	}
+	if (positional.size() > 2) {
+		app.archivePath = positional[2];
+	}
 
 	try {
 		app.run();
@@ -0,0 +1,347 @@
+#include "MemoryAllocator.h"
+#include <stdexcept>
+#include <algorithm>
+
+static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+//Two resources of different tiling share a bufferImageGranularity "page" if the last byte of the first and the first byte of the second land on it.
+static bool OnSamePage(VkDeviceSize endOfFirst, VkDeviceSize startOfSecond, VkDeviceSize pageSize)
+{
+	return (endOfFirst & ~(pageSize - 1)) == (startOfSecond & ~(pageSize - 1));
+}
+
+static bool HasGranularityConflict(MemoryResourceType first, MemoryResourceType second)
+{
+	return first != MemoryResourceType::Free && second != MemoryResourceType::Free && first != second;
+}
+
+float MemoryStats::Fragmentation() const
+{
+	VkDeviceSize freeBytes = BytesReserved - BytesUsed;
+	if (freeBytes == 0)
+	{
+		return 0.0f;
+	}
+
+	return static_cast<float>(FragmentedBytes) / static_cast<float>(freeBytes);
+}
+
+MemoryAllocator::MemoryAllocator()
+{
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+}
+
+void MemoryAllocator::Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+	Device = device;
+	BlockSize = blockSize;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &MemoryProperties);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	BufferImageGranularity = std::max<VkDeviceSize>(deviceProperties.limits.bufferImageGranularity, 1);
+}
+
+void MemoryAllocator::Destroy()
+{
+	std::lock_guard<std::mutex> lock(AllocatorMutex);
+
+	for (auto& block : Blocks)
+	{
+		if (block.MappedData != nullptr)
+		{
+			vkUnmapMemory(Device, block.Memory);
+		}
+		vkFreeMemory(Device, block.Memory, nullptr);
+	}
+
+	Blocks.clear();
+	AllocationCount = 0;
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < MemoryProperties.memoryTypeCount; i++) {
+		if ((typeFilter & (1 << i)) && (MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+bool MemoryAllocator::IsHostVisible(uint32_t memoryTypeIndex) const
+{
+	return (MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+MemoryAllocator::MemoryBlock& MemoryAllocator::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated)
+{
+	MemoryBlock block;
+	block.Size = size;
+	block.MemoryTypeIndex = memoryTypeIndex;
+	block.BlockID = NextBlockID++;
+	block.Dedicated = dedicated;
+
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	if (vkAllocateMemory(Device, &allocInfo, nullptr, &block.Memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate memory block!");
+	}
+
+	if (IsHostVisible(memoryTypeIndex))
+	{
+		if (vkMapMemory(Device, block.Memory, 0, VK_WHOLE_SIZE, 0, &block.MappedData) != VK_SUCCESS) {
+			vkFreeMemory(Device, block.Memory, nullptr);
+			throw std::runtime_error("failed to map memory block!");
+		}
+	}
+
+	block.SubAllocations.push_back({ 0, size, MemoryResourceType::Free });
+	Blocks.push_back(block);
+	return Blocks.back();
+}
+
+void MemoryAllocator::DestroyBlock(MemoryBlock& block)
+{
+	if (block.MappedData != nullptr)
+	{
+		vkUnmapMemory(Device, block.Memory);
+	}
+	vkFreeMemory(Device, block.Memory, nullptr);
+
+	uint32_t blockID = block.BlockID;
+	Blocks.erase(std::remove_if(Blocks.begin(), Blocks.end(), [blockID](const MemoryBlock& x) { return x.BlockID == blockID; }), Blocks.end());
+}
+
+bool MemoryAllocator::TryAllocateFromBlock(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, MemoryResourceType type, MemoryAllocation& allocation)
+{
+	for (size_t i = 0; i < block.SubAllocations.size(); i++)
+	{
+		const SubAllocation range = block.SubAllocations[i];
+		if (range.Type != MemoryResourceType::Free || range.Size < size)
+		{
+			continue;
+		}
+
+		VkDeviceSize offset = range.Offset;
+		if (i > 0)
+		{
+			const SubAllocation& previous = block.SubAllocations[i - 1];
+			if (HasGranularityConflict(previous.Type, type) && OnSamePage(previous.Offset + previous.Size - 1, offset, BufferImageGranularity))
+			{
+				offset = AlignUp(offset, BufferImageGranularity);
+			}
+		}
+		offset = AlignUp(offset, alignment);
+
+		VkDeviceSize rangeEnd = range.Offset + range.Size;
+		if (offset + size > rangeEnd)
+		{
+			continue;
+		}
+
+		if (i + 1 < block.SubAllocations.size())
+		{
+			const SubAllocation& next = block.SubAllocations[i + 1];
+			if (HasGranularityConflict(type, next.Type) && OnSamePage(offset + size - 1, next.Offset, BufferImageGranularity))
+			{
+				continue;
+			}
+		}
+
+		std::vector<SubAllocation> split;
+		if (offset > range.Offset)
+		{
+			split.push_back({ range.Offset, offset - range.Offset, MemoryResourceType::Free });
+		}
+		split.push_back({ offset, size, type });
+		if (offset + size < rangeEnd)
+		{
+			split.push_back({ offset + size, rangeEnd - (offset + size), MemoryResourceType::Free });
+		}
+
+		block.SubAllocations.erase(block.SubAllocations.begin() + i);
+		block.SubAllocations.insert(block.SubAllocations.begin() + i, split.begin(), split.end());
+
+		allocation.Memory = block.Memory;
+		allocation.Offset = offset;
+		allocation.Size = size;
+		allocation.MemoryTypeIndex = block.MemoryTypeIndex;
+		allocation.BlockID = block.BlockID;
+		allocation.MappedData = block.MappedData != nullptr ? static_cast<char*>(block.MappedData) + offset : nullptr;
+		return true;
+	}
+
+	return false;
+}
+
+MemoryAllocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryResourceType type)
+{
+	std::lock_guard<std::mutex> lock(AllocatorMutex);
+
+	uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+	MemoryAllocation allocation;
+
+	//Anything bigger than half a block gets its own VkDeviceMemory so it can't strand the rest of a shared block.
+	if (requirements.size > BlockSize / 2)
+	{
+		MemoryBlock& block = CreateBlock(memoryTypeIndex, requirements.size, true);
+		TryAllocateFromBlock(block, requirements.size, requirements.alignment, type, allocation);
+		AllocationCount++;
+		return allocation;
+	}
+
+	for (auto& block : Blocks)
+	{
+		if (block.MemoryTypeIndex == memoryTypeIndex && !block.Dedicated &&
+			TryAllocateFromBlock(block, requirements.size, requirements.alignment, type, allocation))
+		{
+			AllocationCount++;
+			return allocation;
+		}
+	}
+
+	MemoryBlock& block = CreateBlock(memoryTypeIndex, BlockSize, false);
+	if (!TryAllocateFromBlock(block, requirements.size, requirements.alignment, type, allocation))
+	{
+		throw std::runtime_error("failed to sub-allocate memory!");
+	}
+
+	AllocationCount++;
+	return allocation;
+}
+
+MemoryAllocation MemoryAllocator::AllocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties)
+{
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(Device, buffer, &memRequirements);
+
+	MemoryAllocation allocation = Allocate(memRequirements, properties, MemoryResourceType::Linear);
+	vkBindBufferMemory(Device, buffer, allocation.Memory, allocation.Offset);
+
+	return allocation;
+}
+
+MemoryAllocation MemoryAllocator::AllocateImageMemory(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties)
+{
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(Device, image, &memRequirements);
+
+	MemoryResourceType type = tiling == VK_IMAGE_TILING_OPTIMAL ? MemoryResourceType::Optimal : MemoryResourceType::Linear;
+	MemoryAllocation allocation = Allocate(memRequirements, properties, type);
+	vkBindImageMemory(Device, image, allocation.Memory, allocation.Offset);
+
+	return allocation;
+}
+
+void MemoryAllocator::Free(MemoryAllocation& allocation)
+{
+	if (allocation.Memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(AllocatorMutex);
+
+	for (auto& block : Blocks)
+	{
+		if (block.BlockID != allocation.BlockID)
+		{
+			continue;
+		}
+
+		bool found = false;
+		auto& subAllocations = block.SubAllocations;
+		for (size_t i = 0; i < subAllocations.size(); i++)
+		{
+			if (subAllocations[i].Offset != allocation.Offset || subAllocations[i].Type == MemoryResourceType::Free)
+			{
+				continue;
+			}
+
+			found = true;
+			subAllocations[i].Type = MemoryResourceType::Free;
+			if (i + 1 < subAllocations.size() && subAllocations[i + 1].Type == MemoryResourceType::Free)
+			{
+				subAllocations[i].Size += subAllocations[i + 1].Size;
+				subAllocations.erase(subAllocations.begin() + i + 1);
+			}
+			if (i > 0 && subAllocations[i - 1].Type == MemoryResourceType::Free)
+			{
+				subAllocations[i - 1].Size += subAllocations[i].Size;
+				subAllocations.erase(subAllocations.begin() + i);
+			}
+			break;
+		}
+
+		if (!found)
+		{
+			throw std::runtime_error("failed to free memory allocation!");
+		}
+
+		AllocationCount--;
+		if (block.Dedicated)
+		{
+			DestroyBlock(block);
+		}
+		break;
+	}
+
+	allocation = MemoryAllocation();
+}
+
+MemoryStats MemoryAllocator::GetStats()
+{
+	std::lock_guard<std::mutex> lock(AllocatorMutex);
+
+	MemoryStats stats;
+	stats.BlockCount = static_cast<uint32_t>(Blocks.size());
+	stats.AllocationCount = AllocationCount;
+
+	for (const auto& block : Blocks)
+	{
+		VkDeviceSize blockFree = 0;
+		VkDeviceSize blockLargestFree = 0;
+
+		stats.BytesReserved += block.Size;
+		for (const auto& subAllocation : block.SubAllocations)
+		{
+			if (subAllocation.Type == MemoryResourceType::Free)
+			{
+				stats.FreeRangeCount++;
+				blockFree += subAllocation.Size;
+				blockLargestFree = std::max(blockLargestFree, subAllocation.Size);
+			}
+			else
+			{
+				stats.BytesUsed += subAllocation.Size;
+			}
+		}
+
+		stats.LargestFreeRange = std::max(stats.LargestFreeRange, blockLargestFree);
+		stats.FragmentedBytes += blockFree - blockLargestFree;
+	}
+
+	return stats;
+}
+
+void MemoryAllocator::PrintStats(std::ostream& out)
+{
+	MemoryStats stats = GetStats();
+
+	out << "GPU memory: " << stats.AllocationCount << " allocations in " << stats.BlockCount << " blocks, "
+		<< stats.BytesUsed / 1024 << " KiB used of " << stats.BytesReserved / 1024 << " KiB reserved, "
+		<< stats.FreeRangeCount << " free ranges (largest " << stats.LargestFreeRange / 1024 << " KiB), "
+		<< "fragmentation " << stats.Fragmentation() * 100.0f << "%" << std::endl;
+}
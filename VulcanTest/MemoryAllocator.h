@@ -0,0 +1,93 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <mutex>
+#include <ostream>
+
+//Sub-allocates buffers and images out of large VkDeviceMemory blocks instead of one vkAllocateMemory per resource.
+//Blocks are created per memory type and host visible blocks stay mapped for their whole lifetime.
+
+enum class MemoryResourceType
+{
+	Free,
+	Linear,
+	Optimal
+};
+
+struct MemoryAllocation
+{
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+	uint32_t MemoryTypeIndex = 0;
+	uint32_t BlockID = 0;
+	void* MappedData = nullptr;
+};
+
+struct MemoryStats
+{
+	uint32_t BlockCount = 0;
+	uint32_t AllocationCount = 0;
+	uint32_t FreeRangeCount = 0;
+	VkDeviceSize BytesReserved = 0;
+	VkDeviceSize BytesUsed = 0;
+	VkDeviceSize LargestFreeRange = 0;
+	VkDeviceSize FragmentedBytes = 0;
+
+	//0.0 when every block's free space is one contiguous range, approaching 1.0 as it is split into many small ranges.
+	float Fragmentation() const;
+};
+
+class MemoryAllocator
+{
+private:
+	struct SubAllocation
+	{
+		VkDeviceSize Offset;
+		VkDeviceSize Size;
+		MemoryResourceType Type;
+	};
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		VkDeviceSize Size = 0;
+		uint32_t MemoryTypeIndex = 0;
+		uint32_t BlockID = 0;
+		void* MappedData = nullptr;
+		bool Dedicated = false;
+		std::vector<SubAllocation> SubAllocations;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties MemoryProperties = {};
+	VkDeviceSize BufferImageGranularity = 1;
+	VkDeviceSize BlockSize = 0;
+	uint32_t NextBlockID = 0;
+	uint32_t AllocationCount = 0;
+	std::vector<MemoryBlock> Blocks;
+	std::mutex AllocatorMutex;
+
+	bool TryAllocateFromBlock(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, MemoryResourceType type, MemoryAllocation& allocation);
+	MemoryBlock& CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);
+	void DestroyBlock(MemoryBlock& block);
+	bool IsHostVisible(uint32_t memoryTypeIndex) const;
+
+public:
+	static constexpr VkDeviceSize DefaultBlockSize = 64ull * 1024 * 1024;
+
+	MemoryAllocator();
+	~MemoryAllocator();
+
+	void Initialize(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = DefaultBlockSize);
+	void Destroy();
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	MemoryAllocation Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, MemoryResourceType type);
+	MemoryAllocation AllocateBufferMemory(VkBuffer buffer, VkMemoryPropertyFlags properties);
+	MemoryAllocation AllocateImageMemory(VkImage image, VkImageTiling tiling, VkMemoryPropertyFlags properties);
+	void Free(MemoryAllocation& allocation);
+
+	MemoryStats GetStats();
+	void PrintStats(std::ostream& out);
+};
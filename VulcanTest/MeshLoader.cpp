@@ -0,0 +1,420 @@
+#include "MeshLoader.h"
+#include <cstring>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+#include <stdexcept>
+
+//Tuning constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+static const float CacheDecayPower = 1.5f;
+static const float LastTriangleScore = 0.75f;
+static const float ValenceBoostScale = 2.0f;
+static const float ValenceBoostPower = 0.5f;
+
+static void HashCombine(size_t& seed, float value)
+{
+	seed ^= std::hash<float>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+struct VertexHash
+{
+	size_t operator()(const Vertex& vertex) const
+	{
+		size_t seed = 0;
+		HashCombine(seed, vertex.pos.x);
+		HashCombine(seed, vertex.pos.y);
+		HashCombine(seed, vertex.pos.z);
+		HashCombine(seed, vertex.color.x);
+		HashCombine(seed, vertex.color.y);
+		HashCombine(seed, vertex.color.z);
+		HashCombine(seed, vertex.texCoord.x);
+		HashCombine(seed, vertex.texCoord.y);
+		return seed;
+	}
+};
+
+static float VertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+	if (remainingTriangles == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		//The three vertices of the last triangle get a fixed score so the next triangle doesn't just reuse the same edge.
+		if (cachePosition < 3)
+		{
+			score = LastTriangleScore;
+		}
+		else
+		{
+			float scaler = 1.0f / (MeshLoader::VertexCacheSize - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, CacheDecayPower);
+		}
+	}
+
+	//Vertices with few triangles left are worth finishing off so they can leave the cache for good.
+	score += ValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+	return score;
+}
+
+VkDeviceSize MeshData::GetIndexBufferSize() const
+{
+	return Indices.size() * (IndexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t));
+}
+
+void MeshData::WriteIndices(void* destination) const
+{
+	if (IndexType == VK_INDEX_TYPE_UINT16)
+	{
+		uint16_t* indices16 = static_cast<uint16_t*>(destination);
+		for (size_t i = 0; i < Indices.size(); i++)
+		{
+			indices16[i] = static_cast<uint16_t>(Indices[i]);
+		}
+	}
+	else
+	{
+		std::copy(Indices.begin(), Indices.end(), static_cast<uint32_t*>(destination));
+	}
+}
+
+static uint32_t ResolveObjIndex(const std::string& token, size_t count)
+{
+	long index = std::stol(token);
+	long resolved = index < 0 ? static_cast<long>(count) + index : index - 1;
+	if (resolved < 0 || resolved >= static_cast<long>(count)) {
+		throw std::runtime_error("failed to parse mesh file: index out of range!");
+	}
+
+	return static_cast<uint32_t>(resolved);
+}
+
+MeshData MeshLoader::LoadObj(const AssetView& file)
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> colors;
+	std::vector<glm::vec2> texCoords;
+
+	MeshData mesh;
+	MeshSubset subset = { 0, 0 };
+
+	//Lines are taken straight out of the mapped file rather than through a buffered stream.
+	const char* cursor = reinterpret_cast<const char*>(file.Data);
+	const char* end = cursor + file.Size;
+	std::string line;
+	while (cursor < end)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+		if (lineEnd == nullptr)
+		{
+			lineEnd = end;
+		}
+		line.assign(cursor, lineEnd);
+		cursor = lineEnd < end ? lineEnd + 1 : end;
+
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+
+		if (keyword == "v")
+		{
+			glm::vec3 position;
+			glm::vec3 color(1.0f, 1.0f, 1.0f);
+			stream >> position.x >> position.y >> position.z;
+			if (!(stream >> color.x >> color.y >> color.z))
+			{
+				color = glm::vec3(1.0f, 1.0f, 1.0f);
+			}
+			positions.push_back(position);
+			colors.push_back(color);
+		}
+		else if (keyword == "vt")
+		{
+			glm::vec2 texCoord;
+			stream >> texCoord.x >> texCoord.y;
+			texCoord.y = 1.0f - texCoord.y;
+			texCoords.push_back(texCoord);
+		}
+		else if (keyword == "f")
+		{
+			std::vector<Vertex> polygon;
+			std::string corner;
+			while (stream >> corner)
+			{
+				size_t slash = corner.find('/');
+				uint32_t positionIndex = ResolveObjIndex(corner.substr(0, slash), positions.size());
+
+				Vertex vertex = {};
+				vertex.pos = positions[positionIndex];
+				vertex.color = colors[positionIndex];
+				if (slash != std::string::npos && slash + 1 < corner.size() && corner[slash + 1] != '/')
+				{
+					size_t texCoordEnd = corner.find('/', slash + 1);
+					vertex.texCoord = texCoords[ResolveObjIndex(corner.substr(slash + 1, texCoordEnd - slash - 1), texCoords.size())];
+				}
+				polygon.push_back(vertex);
+			}
+
+			//Fan triangulation; every corner becomes its own vertex here and Deduplicate() merges them afterwards.
+			for (size_t i = 2; i < polygon.size(); i++)
+			{
+				for (const Vertex* vertex : { &polygon[0], &polygon[i - 1], &polygon[i] })
+				{
+					mesh.Indices.push_back(static_cast<uint32_t>(mesh.Vertices.size()));
+					mesh.Vertices.push_back(*vertex);
+				}
+			}
+		}
+		else if (keyword == "o" || keyword == "g" || keyword == "usemtl")
+		{
+			subset.IndexCount = static_cast<uint32_t>(mesh.Indices.size()) - subset.FirstIndex;
+			if (subset.IndexCount > 0)
+			{
+				mesh.Subsets.push_back(subset);
+			}
+			subset.FirstIndex = static_cast<uint32_t>(mesh.Indices.size());
+		}
+	}
+
+	subset.IndexCount = static_cast<uint32_t>(mesh.Indices.size()) - subset.FirstIndex;
+	if (subset.IndexCount > 0)
+	{
+		mesh.Subsets.push_back(subset);
+	}
+
+	if (mesh.Indices.empty()) {
+		throw std::runtime_error("failed to parse mesh file: no faces!");
+	}
+
+	Finalize(mesh);
+	return mesh;
+}
+
+MeshData MeshLoader::FromGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<MeshSubset>& subsets)
+{
+	MeshData mesh;
+	mesh.Vertices = vertices;
+	mesh.Indices = indices;
+	mesh.Subsets = subsets;
+	if (mesh.Subsets.empty())
+	{
+		mesh.Subsets.push_back({ 0, static_cast<uint32_t>(indices.size()) });
+	}
+
+	Finalize(mesh);
+	return mesh;
+}
+
+void MeshLoader::Finalize(MeshData& mesh)
+{
+	Deduplicate(mesh);
+	for (const auto& subset : mesh.Subsets)
+	{
+		OptimizeVertexCache(mesh.Indices, subset, mesh.Vertices.size());
+	}
+	OptimizeVertexFetch(mesh);
+
+	mesh.IndexType = mesh.Vertices.size() <= UINT16_MAX ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+}
+
+void MeshLoader::Deduplicate(MeshData& mesh)
+{
+	std::unordered_map<Vertex, uint32_t, VertexHash> uniqueVertices;
+	uniqueVertices.reserve(mesh.Vertices.size());
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> remap(mesh.Vertices.size());
+	for (size_t i = 0; i < mesh.Vertices.size(); i++)
+	{
+		auto inserted = uniqueVertices.emplace(mesh.Vertices[i], static_cast<uint32_t>(vertices.size()));
+		if (inserted.second)
+		{
+			vertices.push_back(mesh.Vertices[i]);
+		}
+		remap[i] = inserted.first->second;
+	}
+
+	for (auto& index : mesh.Indices)
+	{
+		index = remap[index];
+	}
+	mesh.Vertices.swap(vertices);
+}
+
+void MeshLoader::OptimizeVertexCache(std::vector<uint32_t>& indices, const MeshSubset& subset, size_t vertexCount)
+{
+	uint32_t triangleCount = subset.IndexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+	const uint32_t* source = &indices[subset.FirstIndex];
+
+	//Vertex -> triangle adjacency, packed; each vertex's live triangles are the first remainingTriangles entries of its range.
+	std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		remainingTriangles[source[i]]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+	}
+
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[source[i]]++] = i / 3;
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount, -1.0f);
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = VertexScore(-1, remainingTriangles[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	int bestTriangle = 0;
+	for (uint32_t t = 0; t < triangleCount; t++)
+	{
+		triangleScores[t] = vertexScores[source[t * 3]] + vertexScores[source[t * 3 + 1]] + vertexScores[source[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+		{
+			bestTriangle = static_cast<int>(t);
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(triangleCount * 3);
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(VertexCacheSize + 3);
+	newCache.reserve(VertexCacheSize + 3);
+	uint32_t scanCursor = 0;
+
+	while (output.size() < triangleCount * 3)
+	{
+		//Nothing in the cache touches a live triangle any more; continue from the first one not yet emitted.
+		if (bestTriangle < 0)
+		{
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			bestTriangle = static_cast<int>(scanCursor);
+		}
+
+		const uint32_t* triangle = &source[bestTriangle * 3];
+		emitted[bestTriangle] = true;
+
+		newCache.clear();
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t v = triangle[corner];
+			output.push_back(v);
+
+			uint32_t* first = &adjacency[adjacencyOffsets[v]];
+			uint32_t* last = first + remainingTriangles[v];
+			uint32_t* found = std::find(first, last, static_cast<uint32_t>(bestTriangle));
+			std::swap(*found, *(last - 1));
+			remainingTriangles[v]--;
+
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		for (uint32_t v : cache)
+		{
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		//Rescore everything that moved in or fell out of the cache, then pick the best triangle touching those vertices.
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			uint32_t v = newCache[i];
+			cachePositions[v] = i < VertexCacheSize ? static_cast<int>(i) : -1;
+			vertexScores[v] = VertexScore(cachePositions[v], remainingTriangles[v]);
+		}
+
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (uint32_t v : newCache)
+		{
+			for (uint32_t a = 0; a < remainingTriangles[v]; a++)
+			{
+				uint32_t t = adjacency[adjacencyOffsets[v] + a];
+				triangleScores[t] = vertexScores[source[t * 3]] + vertexScores[source[t * 3 + 1]] + vertexScores[source[t * 3 + 2]];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = static_cast<int>(t);
+				}
+			}
+		}
+
+		if (newCache.size() > VertexCacheSize)
+		{
+			newCache.resize(VertexCacheSize);
+		}
+		cache.swap(newCache);
+	}
+
+	std::copy(output.begin(), output.end(), indices.begin() + subset.FirstIndex);
+}
+
+void MeshLoader::OptimizeVertexFetch(MeshData& mesh)
+{
+	const uint32_t unassigned = UINT32_MAX;
+	std::vector<uint32_t> remap(mesh.Vertices.size(), unassigned);
+	std::vector<Vertex> vertices;
+	vertices.reserve(mesh.Vertices.size());
+
+	for (auto& index : mesh.Indices)
+	{
+		if (remap[index] == unassigned)
+		{
+			remap[index] = static_cast<uint32_t>(vertices.size());
+			vertices.push_back(mesh.Vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	mesh.Vertices.swap(vertices);
+}
+
+float MeshLoader::ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	//A FIFO cache is a window over the last cacheSize misses, so each vertex only needs the miss count it was loaded at.
+	std::vector<uint64_t> loadedAt(vertexCount, UINT64_MAX);
+	uint64_t misses = 0;
+	for (uint32_t index : indices)
+	{
+		if (loadedAt[index] == UINT64_MAX || misses - loadedAt[index] >= cacheSize)
+		{
+			loadedAt[index] = misses;
+			misses++;
+		}
+	}
+
+	return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <string>
+#include "VertexBuffer.h"
+#include "AssetReader.h"
+
+struct MeshSubset
+{
+	uint32_t FirstIndex;
+	uint32_t IndexCount;
+};
+
+struct MeshData
+{
+	std::vector<Vertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<MeshSubset> Subsets;
+	VkIndexType IndexType = VK_INDEX_TYPE_UINT32;
+
+	VkDeviceSize GetIndexBufferSize() const;
+	void WriteIndices(void* destination) const;
+};
+
+//Builds GPU ready triangle lists: identical vertices are merged, triangles inside each subset are reordered for the
+//post-transform vertex cache (Forsyth's linear-speed optimizer), vertices are renumbered in first-use order for fetch
+//locality, and the index type drops to uint16 whenever every index fits.
+class MeshLoader
+{
+private:
+	static void Deduplicate(MeshData& mesh);
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, const MeshSubset& subset, size_t vertexCount);
+	static void OptimizeVertexFetch(MeshData& mesh);
+	static void Finalize(MeshData& mesh);
+
+public:
+	static constexpr uint32_t VertexCacheSize = 32;
+
+	//Triangulates polygons and starts a new subset at every o/g/usemtl statement.
+	static MeshData LoadObj(const AssetView& file);
+	static MeshData FromGeometry(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const std::vector<MeshSubset>& subsets);
+
+	//Average cache miss ratio (vertex shader invocations per triangle) for a FIFO cache of the given size.
+	static float ComputeACMR(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize);
+};
@@ -0,0 +1,91 @@
+#include "MipmapGenerator.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define MIPMAP_USE_SSE2
+#endif
+
+static const uint32_t BytesPerPixel = 4;
+
+//Averages 2x2 blocks of src into dst; an odd last row or column is clamped so every output pixel has four taps.
+static void DownsampleBox(const uint8_t* src, uint32_t srcWidth, uint32_t srcHeight, uint8_t* dst, uint32_t dstWidth, uint32_t dstHeight)
+{
+	for (uint32_t y = 0; y < dstHeight; y++)
+	{
+		const uint8_t* row0 = src + static_cast<size_t>(std::min(2 * y, srcHeight - 1)) * srcWidth * BytesPerPixel;
+		const uint8_t* row1 = src + static_cast<size_t>(std::min(2 * y + 1, srcHeight - 1)) * srcWidth * BytesPerPixel;
+		uint8_t* out = dst + static_cast<size_t>(y) * dstWidth * BytesPerPixel;
+
+		uint32_t x = 0;
+#ifdef MIPMAP_USE_SSE2
+		//Two output pixels per iteration: widen four source pixels from each row to 16 bits, add the rows, then add
+		//horizontal neighbours and round.
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i rounding = _mm_set1_epi16(2);
+		for (; x + 1 < dstWidth && 2 * x + 3 < srcWidth; x += 2)
+		{
+			__m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 2 * BytesPerPixel));
+			__m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 2 * BytesPerPixel));
+
+			__m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+			__m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+			left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+			right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+
+			__m128i sum = _mm_unpacklo_epi64(left, right);
+			sum = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(out + x * BytesPerPixel), _mm_packus_epi16(sum, sum));
+		}
+#endif
+		for (; x < dstWidth; x++)
+		{
+			uint32_t x0 = std::min(2 * x, srcWidth - 1) * BytesPerPixel;
+			uint32_t x1 = std::min(2 * x + 1, srcWidth - 1) * BytesPerPixel;
+			for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+			{
+				uint32_t sum = row0[x0 + channel] + row0[x1 + channel] + row1[x0 + channel] + row1[x1 + channel];
+				out[x * BytesPerPixel + channel] = static_cast<uint8_t>((sum + 2) >> 2);
+			}
+		}
+	}
+}
+
+uint32_t MipmapGenerator::GetMipLevelCount(uint32_t width, uint32_t height)
+{
+	return static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+}
+
+std::vector<MipLevel> MipmapGenerator::GenerateLevels(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t mipLevels, std::vector<uint8_t>& data)
+{
+	std::vector<MipLevel> levels(mipLevels);
+
+	VkDeviceSize offset = 0;
+	uint32_t levelWidth = width;
+	uint32_t levelHeight = height;
+	for (auto& level : levels)
+	{
+		level.Width = levelWidth;
+		level.Height = levelHeight;
+		level.Offset = offset;
+		level.Size = static_cast<VkDeviceSize>(levelWidth) * levelHeight * BytesPerPixel;
+		offset += level.Size;
+
+		levelWidth = std::max(levelWidth / 2, 1u);
+		levelHeight = std::max(levelHeight / 2, 1u);
+	}
+
+	data.resize(static_cast<size_t>(offset));
+	memcpy(data.data(), pixels, static_cast<size_t>(levels[0].Size));
+
+	for (uint32_t i = 1; i < mipLevels; i++)
+	{
+		const MipLevel& source = levels[i - 1];
+		const MipLevel& destination = levels[i];
+		DownsampleBox(data.data() + source.Offset, source.Width, source.Height, data.data() + destination.Offset, destination.Width, destination.Height);
+	}
+
+	return levels;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+
+struct MipLevel
+{
+	uint32_t Width;
+	uint32_t Height;
+	VkDeviceSize Offset;
+	VkDeviceSize Size;
+};
+
+//Builds full mip chains for RGBA8 textures on the CPU with a 2x2 box filter (SSE2 where available), so every level exists
+//before anything is uploaded and the texture streamer can send the small levels first.
+class MipmapGenerator
+{
+public:
+	static uint32_t GetMipLevelCount(uint32_t width, uint32_t height);
+
+	//Writes all levels of a tightly packed RGBA8 image into data, level 0 first, and returns where each one starts.
+	static std::vector<MipLevel> GenerateLevels(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t mipLevels, std::vector<uint8_t>& data);
+};
@@ -0,0 +1,196 @@
+#include "PipelineCache.h"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+
+PipelineCache::PipelineCache()
+{
+}
+
+PipelineCache::~PipelineCache()
+{
+}
+
+void PipelineCache::Create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, bool enableCreationFeedback)
+{
+	Device = device;
+	Path = path;
+	CreationFeedbackEnabled = enableCreationFeedback;
+	LoadedFromDisk = false;
+	DiscardReason.clear();
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	std::vector<char> data;
+	std::ifstream file(Path, std::ios::ate | std::ios::binary);
+	if (file.is_open())
+	{
+		data.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(data.data(), data.size());
+		file.close();
+
+		if (!ValidateHeader(data, properties, DiscardReason))
+		{
+			data.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	cacheInfo.initialDataSize = data.size();
+	cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(Device, &cacheInfo, nullptr, &Cache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+
+	LoadedFromDisk = !data.empty();
+}
+
+bool PipelineCache::ValidateHeader(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties, std::string& reason)
+{
+	if (data.size() < HeaderSize)
+	{
+		reason = "truncated header";
+		return false;
+	}
+
+	//VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, then the 16 byte cache UUID.
+	uint32_t header[4];
+	memcpy(header, data.data(), sizeof(header));
+
+	if (header[0] < HeaderSize || header[0] > data.size())
+	{
+		reason = "bad header size";
+		return false;
+	}
+	if (header[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+	{
+		reason = "unknown header version";
+		return false;
+	}
+	if (header[2] != properties.vendorID || header[3] != properties.deviceID)
+	{
+		reason = "different device";
+		return false;
+	}
+	if (memcmp(data.data() + sizeof(header), properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		reason = "different driver";
+		return false;
+	}
+
+	return true;
+}
+
+void PipelineCache::Save()
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(Device, Cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+	{
+		return;
+	}
+
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(Device, Cache, &dataSize, data.data()) != VK_SUCCESS) {
+		throw std::runtime_error("failed to read pipeline cache data!");
+	}
+
+	//Write next to the real file and swap it in, so a crash mid-write can't leave a torn cache behind.
+	std::string tempPath = Path + ".tmp";
+	std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		return;
+	}
+	file.write(data.data(), dataSize);
+	file.close();
+
+	std::remove(Path.c_str());
+	std::rename(tempPath.c_str(), Path.c_str());
+}
+
+void PipelineCache::Destroy()
+{
+	if (Cache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	Save();
+	vkDestroyPipelineCache(Device, Cache, nullptr);
+	Cache = VK_NULL_HANDLE;
+}
+
+const void* PipelineCache::BeginCreate(uint32_t stageCount)
+{
+	CreateStart = std::chrono::high_resolution_clock::now();
+
+	if (!CreationFeedbackEnabled)
+	{
+		return nullptr;
+	}
+
+	PipelineFeedback = {};
+	StageFeedbacks.assign(stageCount, VkPipelineCreationFeedbackEXT());
+
+	FeedbackInfo = {};
+	FeedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+	FeedbackInfo.pPipelineCreationFeedback = &PipelineFeedback;
+	FeedbackInfo.pipelineStageCreationFeedbackCount = stageCount;
+	FeedbackInfo.pPipelineStageCreationFeedbacks = StageFeedbacks.data();
+
+	return &FeedbackInfo;
+}
+
+void PipelineCache::EndCreate(const char* name)
+{
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - CreateStart;
+
+	CreationRecord record = { name, elapsed.count(), false, false };
+	if (CreationFeedbackEnabled && (PipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT))
+	{
+		record.FeedbackValid = true;
+		record.CacheHit = (PipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) != 0;
+	}
+
+	Records.push_back(record);
+}
+
+void PipelineCache::PrintStats(std::ostream& out)
+{
+	double totalMilliseconds = 0.0;
+	uint32_t pipelineCount = 0;
+	uint32_t hitCount = 0;
+
+	out << "Pipeline cache: " << (LoadedFromDisk ? "warm" : "cold") << " start from " << Path;
+	if (!DiscardReason.empty())
+	{
+		out << " (discarded stale cache: " << DiscardReason << ")";
+	}
+	out << std::endl;
+
+	for (const auto& record : Records)
+	{
+		pipelineCount++;
+		totalMilliseconds += record.Milliseconds;
+		hitCount += record.CacheHit ? 1 : 0;
+
+		out << "  " << record.Name << ": " << record.Milliseconds << " ms";
+		if (record.FeedbackValid)
+		{
+			out << (record.CacheHit ? " (cache hit)" : " (cache miss)");
+		}
+		out << std::endl;
+	}
+
+	out << "  " << pipelineCount << " pipelines in " << totalMilliseconds << " ms";
+	if (CreationFeedbackEnabled)
+	{
+		out << ", " << hitCount << " cache hits";
+	}
+	out << std::endl;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <ostream>
+
+//A VkPipelineCache seeded from disk and written back on Destroy().
+//The file's header is checked against the device's vendor ID, device ID and pipelineCacheUUID so a cache from another
+//GPU or driver is discarded instead of handed to the driver. Every pipeline creation is bracketed by BeginCreate/EndCreate
+//for timing, and when VK_EXT_pipeline_creation_feedback is enabled the driver's own cache hit flag is reported too.
+class PipelineCache
+{
+private:
+	struct CreationRecord
+	{
+		std::string Name;
+		double Milliseconds;
+		bool FeedbackValid;
+		bool CacheHit;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkPipelineCache Cache = VK_NULL_HANDLE;
+	std::string Path;
+	bool LoadedFromDisk = false;
+	bool CreationFeedbackEnabled = false;
+	std::string DiscardReason;
+
+	VkPipelineCreationFeedbackEXT PipelineFeedback = {};
+	std::vector<VkPipelineCreationFeedbackEXT> StageFeedbacks;
+	VkPipelineCreationFeedbackCreateInfoEXT FeedbackInfo = {};
+	std::chrono::high_resolution_clock::time_point CreateStart;
+	std::vector<CreationRecord> Records;
+
+	bool ValidateHeader(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties, std::string& reason);
+
+public:
+	static constexpr uint32_t HeaderSize = 16 + VK_UUID_SIZE;
+
+	PipelineCache();
+	~PipelineCache();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, const std::string& path, bool enableCreationFeedback);
+	void Save();
+	void Destroy();
+
+	VkPipelineCache GetCache() { return Cache; }
+	bool IsWarm() { return LoadedFromDisk; }
+
+	//Returns the pNext chain to attach to the pipeline create info (null without creation feedback).
+	const void* BeginCreate(uint32_t stageCount);
+	void EndCreate(const char* name);
+
+	void PrintStats(std::ostream& out);
+};
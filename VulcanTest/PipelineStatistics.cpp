@@ -0,0 +1,177 @@
+#include "PipelineStatistics.h"
+#include <stdexcept>
+
+//Results come back in the order of the flag bits, one uint64_t per counter.
+const VkQueryPipelineStatisticFlags PipelineStatistics::CounterFlags =
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+	VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+static const uint32_t CounterCount = 6;
+
+DrawStatistics& DrawStatistics::operator+=(const DrawStatistics& other)
+{
+	InputVertices += other.InputVertices;
+	InputPrimitives += other.InputPrimitives;
+	VertexInvocations += other.VertexInvocations;
+	ClippingInvocations += other.ClippingInvocations;
+	ClippingPrimitives += other.ClippingPrimitives;
+	FragmentInvocations += other.FragmentInvocations;
+	return *this;
+}
+
+PipelineStatistics::PipelineStatistics()
+{
+}
+
+PipelineStatistics::~PipelineStatistics()
+{
+}
+
+void PipelineStatistics::Create(VkDevice device, bool enabled, uint32_t frameCount, uint32_t maxQueriesPerFrame)
+{
+	Device = device;
+	MaxQueries = maxQueriesPerFrame;
+	Frames.assign(frameCount, FrameQueries());
+	Enabled = enabled && MaxQueries > 0;
+	if (!Enabled)
+	{
+		return;
+	}
+
+	VkQueryPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	poolInfo.queryCount = frameCount * MaxQueries;
+	poolInfo.pipelineStatistics = CounterFlags;
+
+	if (vkCreateQueryPool(Device, &poolInfo, nullptr, &QueryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline statistics query pool!");
+	}
+}
+
+void PipelineStatistics::Destroy()
+{
+	if (QueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(Device, QueryPool, nullptr);
+		QueryPool = VK_NULL_HANDLE;
+	}
+
+	Enabled = false;
+	Frames.clear();
+}
+
+bool PipelineStatistics::Collect(uint32_t frame)
+{
+	FrameQueries& queries = Frames[frame];
+	if (!Enabled || !queries.Pending || queries.QueryCount == 0)
+	{
+		return false;
+	}
+	queries.Pending = false;
+
+	//Every query is followed by its availability word.
+	const uint32_t stride = CounterCount + 1;
+	Results.resize(static_cast<size_t>(queries.QueryCount) * stride);
+	VkResult result = vkGetQueryPoolResults(Device, QueryPool, GetFirstQuery(frame), queries.QueryCount, Results.size() * sizeof(uint64_t), Results.data(),
+		stride * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		throw std::runtime_error("failed to read pipeline statistics queries!");
+	}
+
+	DrawStatistics frameStatistics;
+	bool anyAvailable = false;
+	for (uint32_t i = 0; i < queries.QueryCount; i++)
+	{
+		const uint64_t* counters = &Results[static_cast<size_t>(i) * stride];
+		if (counters[CounterCount] == 0)
+		{
+			continue;
+		}
+
+		DrawStatistics query;
+		query.InputVertices = counters[0];
+		query.InputPrimitives = counters[1];
+		query.VertexInvocations = counters[2];
+		query.ClippingInvocations = counters[3];
+		query.ClippingPrimitives = counters[4];
+		query.FragmentInvocations = counters[5];
+		frameStatistics += query;
+		anyAvailable = true;
+	}
+
+	if (!anyAvailable)
+	{
+		return false;
+	}
+
+	LastFrame = frameStatistics;
+	Total += frameStatistics;
+	CollectedFrameCount++;
+	return true;
+}
+
+void PipelineStatistics::Reset(VkCommandBuffer commandBuffer, uint32_t frame)
+{
+	Frames[frame].QueryCount = 0;
+	Frames[frame].Pending = false;
+
+	if (Enabled)
+	{
+		vkCmdResetQueryPool(commandBuffer, QueryPool, GetFirstQuery(frame), MaxQueries);
+	}
+}
+
+uint32_t PipelineStatistics::AddQuery(uint32_t frame)
+{
+	FrameQueries& queries = Frames[frame];
+	if (!Enabled)
+	{
+		return 0;
+	}
+	if (queries.QueryCount >= MaxQueries)
+	{
+		throw std::runtime_error("too many pipeline statistics queries in one frame!");
+	}
+
+	queries.Pending = true;
+	return queries.QueryCount++;
+}
+
+void PipelineStatistics::Begin(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t query)
+{
+	if (Enabled)
+	{
+		vkCmdBeginQuery(commandBuffer, QueryPool, GetFirstQuery(frame) + query, 0);
+	}
+}
+
+void PipelineStatistics::End(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t query)
+{
+	if (Enabled)
+	{
+		vkCmdEndQuery(commandBuffer, QueryPool, GetFirstQuery(frame) + query);
+	}
+}
+
+void PipelineStatistics::PrintStats(std::ostream& out, uint64_t pixelCount)
+{
+	if (CollectedFrameCount == 0)
+	{
+		return;
+	}
+
+	double frames = CollectedFrameCount;
+	const DrawStatistics& last = LastFrame;
+	out << "Pipeline statistics: averages over " << CollectedFrameCount << " frames" << std::endl;
+	out << "  input assembly: " << Total.InputVertices / frames << " vertices, " << Total.InputPrimitives / frames << " primitives" << std::endl;
+	out << "  vertex shader: " << Total.VertexInvocations / frames << " invocations, " << Total.VerticesPerTriangle() << " per triangle" << std::endl;
+	out << "  clipping: " << Total.ClippingInvocations / frames << " primitives in, " << Total.ClippingPrimitives / frames << " out" << std::endl;
+	out << "  fragment shader: " << Total.FragmentInvocations / frames << " invocations, " << Total.Overdraw(pixelCount) / frames << "x overdraw" << std::endl;
+	out << "  last frame: " << last.VertexInvocations << " vertex and " << last.FragmentInvocations << " fragment invocations" << std::endl;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <ostream>
+
+//Counters of one pipeline statistics query, or their sum over a frame.
+struct DrawStatistics
+{
+	uint64_t InputVertices = 0;
+	uint64_t InputPrimitives = 0;
+	uint64_t VertexInvocations = 0;
+	uint64_t ClippingInvocations = 0;
+	uint64_t ClippingPrimitives = 0;
+	uint64_t FragmentInvocations = 0;
+
+	//Vertex shader invocations per triangle; 3.0 without any post-transform reuse, approaching 0.5 on a regular grid.
+	double VerticesPerTriangle() const { return InputPrimitives > 0 ? static_cast<double>(VertexInvocations) / InputPrimitives : 0.0; }
+	//Fragment shader invocations per pixel of a target of pixelCount pixels.
+	double Overdraw(uint64_t pixelCount) const { return pixelCount > 0 ? static_cast<double>(FragmentInvocations) / pixelCount : 0.0; }
+
+	DrawStatistics& operator+=(const DrawStatistics& other);
+};
+
+//Optional VK_QUERY_TYPE_PIPELINE_STATISTICS queries around groups of draws, laid out like GpuTimer: a range of the pool
+//per frame in flight, read back without waiting once that frame's fence has signalled. Needs the pipelineStatisticsQuery
+//device feature; when it is missing or not asked for every call is a no-op.
+class PipelineStatistics
+{
+private:
+	struct FrameQueries
+	{
+		uint32_t QueryCount = 0;
+		bool Pending = false;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkQueryPool QueryPool = VK_NULL_HANDLE;
+	bool Enabled = false;
+	uint32_t MaxQueries = 0;
+
+	std::vector<FrameQueries> Frames;
+	std::vector<uint64_t> Results;
+	DrawStatistics LastFrame;
+	DrawStatistics Total;
+	uint32_t CollectedFrameCount = 0;
+
+	uint32_t GetFirstQuery(uint32_t frame) const { return frame * MaxQueries; }
+
+public:
+	static const VkQueryPipelineStatisticFlags CounterFlags;
+
+	PipelineStatistics();
+	~PipelineStatistics();
+
+	//enabled is false when the feature was not requested or the device lacks it.
+	void Create(VkDevice device, bool enabled, uint32_t frameCount, uint32_t maxQueriesPerFrame);
+	void Destroy();
+	bool IsEnabled() const { return Enabled; }
+
+	//Sums the frame's previous queries into GetFrameStatistics(). Call after the frame's fence has signalled.
+	bool Collect(uint32_t frame);
+	//Must be recorded outside a render pass, ahead of every query of the frame.
+	void Reset(VkCommandBuffer commandBuffer, uint32_t frame);
+	//Reserves a query for this frame. Not thread safe, like GpuTimer::AddScope.
+	uint32_t AddQuery(uint32_t frame);
+	//Begin and end must be recorded into the same command buffer and subpass.
+	void Begin(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t query);
+	void End(VkCommandBuffer commandBuffer, uint32_t frame, uint32_t query);
+
+	//Counters of the most recently collected frame.
+	const DrawStatistics& GetFrameStatistics() const { return LastFrame; }
+	//Prints nothing until a frame was collected; still works after Destroy().
+	void PrintStats(std::ostream& out, uint64_t pixelCount);
+};
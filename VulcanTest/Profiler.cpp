@@ -0,0 +1,142 @@
+#include "Profiler.h"
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+
+struct ProfileZone
+{
+	const char* Name;
+	uint64_t Start;
+	uint64_t End;
+};
+
+//Written only by its own thread; read by WriteChromeTrace() once recording has stopped.
+struct ProfileThreadBuffer
+{
+	uint32_t ThreadId = 0;
+	std::string Name;
+	std::vector<ProfileZone> Zones;
+	uint64_t RecordedCount = 0;
+};
+
+//Buffers are owned here as well so zones of threads that already exited still make it into the trace.
+static std::mutex RegistryMutex;
+static std::vector<std::shared_ptr<ProfileThreadBuffer>> Registry;
+
+static thread_local std::shared_ptr<ProfileThreadBuffer> LocalBuffer;
+static thread_local std::string LocalThreadName;
+
+//Only Record() gets here, so threads of a run without profiling never allocate a ring.
+static ProfileThreadBuffer& GetLocalBuffer()
+{
+	if (!LocalBuffer)
+	{
+		LocalBuffer = std::make_shared<ProfileThreadBuffer>();
+		LocalBuffer->Name = LocalThreadName;
+		LocalBuffer->Zones.resize(Profiler::RingCapacity);
+
+		std::lock_guard<std::mutex> lock(RegistryMutex);
+		LocalBuffer->ThreadId = static_cast<uint32_t>(Registry.size());
+		Registry.push_back(LocalBuffer);
+	}
+	return *LocalBuffer;
+}
+
+static void WriteJsonString(std::ostream& out, const std::string& text)
+{
+	out << '"';
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\')
+		{
+			out << '\\';
+		}
+		out << c;
+	}
+	out << '"';
+}
+
+std::atomic<bool> Profiler::Enabled(false);
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	LocalThreadName = name;
+	if (LocalBuffer)
+	{
+		LocalBuffer->Name = name;
+	}
+}
+
+void Profiler::Record(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds)
+{
+	ProfileThreadBuffer& buffer = GetLocalBuffer();
+	ProfileZone& zone = buffer.Zones[buffer.RecordedCount % RingCapacity];
+	zone.Name = name;
+	zone.Start = startNanoseconds;
+	zone.End = endNanoseconds;
+	buffer.RecordedCount++;
+}
+
+uint64_t Profiler::Now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Profiler::WriteChromeTrace(const std::string& path)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		throw std::runtime_error("failed to open " + path + " for writing!");
+	}
+
+	std::lock_guard<std::mutex> lock(RegistryMutex);
+
+	//Timestamps are written relative to the earliest zone so the trace starts at zero.
+	uint64_t origin = UINT64_MAX;
+	for (const auto& buffer : Registry)
+	{
+		uint64_t count = std::min<uint64_t>(buffer->RecordedCount, RingCapacity);
+		for (uint64_t i = 0; i < count; i++)
+		{
+			origin = std::min(origin, buffer->Zones[i].Start);
+		}
+	}
+
+	file.setf(std::ios::fixed);
+	file.precision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	bool first = true;
+	for (const auto& buffer : Registry)
+	{
+		if (!buffer->Name.empty())
+		{
+			file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->ThreadId << ",\"args\":{\"name\":";
+			WriteJsonString(file, buffer->Name);
+			file << "}}";
+			first = false;
+		}
+
+		//Oldest zone first; once the ring has wrapped that is the one at the write position.
+		uint64_t count = std::min<uint64_t>(buffer->RecordedCount, RingCapacity);
+		uint64_t firstIndex = buffer->RecordedCount - count;
+		for (uint64_t i = 0; i < count; i++)
+		{
+			const ProfileZone& zone = buffer->Zones[(firstIndex + i) % RingCapacity];
+			file << (first ? "\n" : ",\n") << "{\"name\":";
+			WriteJsonString(file, zone.Name);
+			file << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->ThreadId << ",\"ts\":" << (zone.Start - origin) / 1000.0
+				<< ",\"dur\":" << (zone.End - zone.Start) / 1000.0 << "}";
+			first = false;
+		}
+	}
+
+	file << "\n]}\n";
+	if (!file) {
+		throw std::runtime_error("failed to write " + path + "!");
+	}
+}
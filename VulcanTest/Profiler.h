@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <atomic>
+
+//Scoped CPU zones written to a Chrome trace (chrome://tracing, ui.perfetto.dev or Tracy's import-chrome).
+//Every thread records into its own fixed size ring buffer, so recording takes no lock and the oldest zones are
+//overwritten on long runs. When profiling is compiled in but not enabled a zone costs one relaxed atomic load;
+//release builds (NDEBUG) compile the macros out entirely unless VULCANTEST_PROFILING is defined.
+#if !defined(NDEBUG) || defined(VULCANTEST_PROFILING)
+#define PROFILING_COMPILED_IN 1
+#endif
+
+class Profiler
+{
+private:
+	static std::atomic<bool> Enabled;
+
+public:
+	//Zones kept per thread before the oldest are overwritten.
+	static constexpr uint32_t RingCapacity = 1 << 16;
+
+	static void SetEnabled(bool enabled) { Enabled.store(enabled, std::memory_order_relaxed); }
+	static bool IsEnabled() { return Enabled.load(std::memory_order_relaxed); }
+	static constexpr bool IsCompiledIn()
+	{
+#ifdef PROFILING_COMPILED_IN
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	//Names the calling thread's row in the trace. Only keeps the name; the thread's ring is allocated by its first Record().
+	static void SetThreadName(const std::string& name);
+	//name must outlive the profiler, in practice a string literal.
+	static void Record(const char* name, uint64_t startNanoseconds, uint64_t endNanoseconds);
+	static uint64_t Now();
+
+	//Call while no other thread is recording, e.g. after shutdown.
+	static void WriteChromeTrace(const std::string& path);
+};
+
+class ProfileScope
+{
+private:
+	const char* Name;
+	uint64_t Start;
+
+public:
+	explicit ProfileScope(const char* name) : Name(name), Start(Profiler::IsEnabled() ? Profiler::Now() : 0) {}
+	~ProfileScope()
+	{
+		if (Start != 0)
+		{
+			Profiler::Record(Name, Start, Profiler::Now());
+		}
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PROFILING_COMPILED_IN
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD(name) Profiler::SetThreadName(name)
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#endif
@@ -0,0 +1,150 @@
+#include "StagingBufferPool.h"
+#include "BufferManager.h"
+#include <stdexcept>
+
+StagingBufferPool::StagingBufferPool()
+{
+}
+
+StagingBufferPool::~StagingBufferPool()
+{
+}
+
+void StagingBufferPool::Create(MemoryAllocator& allocator, VkDevice device, UploadContext& uploadContext, VkDeviceSize budget, VkDeviceSize alignment)
+{
+	Allocator = &allocator;
+	Uploads = &uploadContext;
+	Device = device;
+	Budget = budget;
+	Alignment = alignment > 0 ? alignment : 1;
+	Head = 0;
+	Tail = 0;
+
+	BufferManager::CreateBuffer(allocator, device, Budget, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, Buffer, BufferMemory);
+}
+
+void StagingBufferPool::Destroy()
+{
+	if (!InFlightChunks.empty())
+	{
+		Uploads->Wait(InFlightChunks.back().Token);
+	}
+
+	vkDestroyBuffer(Device, Buffer, nullptr);
+	Allocator->Free(BufferMemory);
+	Buffer = VK_NULL_HANDLE;
+}
+
+bool StagingBufferPool::TryAllocate(VkDeviceSize size, VkDeviceSize& offset, VkDeviceSize& end)
+{
+	if (InFlightChunks.empty())
+	{
+		Head = 0;
+		Tail = 0;
+	}
+
+	VkDeviceSize alignedHead = (Head + Alignment - 1) / Alignment * Alignment;
+
+	//Free space is [Head, Budget) plus [0, Tail) while the ring hasn't wrapped, and [Head, Tail) once it has.
+	if (InFlightChunks.empty() || Head > Tail)
+	{
+		if (alignedHead + size <= Budget)
+		{
+			offset = alignedHead;
+			end = alignedHead + size;
+			return true;
+		}
+		if (size <= Tail)
+		{
+			//Wrapping wastes the end of the buffer; the chunk keeps it until it is released.
+			offset = 0;
+			end = size;
+			return true;
+		}
+		return false;
+	}
+
+	if (alignedHead + size <= Tail)
+	{
+		offset = alignedHead;
+		end = alignedHead + size;
+		return true;
+	}
+
+	return false;
+}
+
+void StagingBufferPool::ReleaseOldest()
+{
+	InFlightChunks.pop_front();
+	if (!InFlightChunks.empty())
+	{
+		Tail = InFlightChunks.front().Offset;
+	}
+}
+
+StagingAllocation StagingBufferPool::AllocateDedicated(VkDeviceSize size)
+{
+	StagingAllocation allocation;
+	MemoryAllocation memory;
+	BufferManager::CreateBuffer(*Allocator, Device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, allocation.Buffer, memory);
+
+	allocation.Offset = 0;
+	allocation.Size = size;
+	allocation.MappedData = memory.MappedData;
+
+	VkBuffer buffer = allocation.Buffer;
+	MemoryAllocator* allocator = Allocator;
+	VkDevice device = Device;
+	Uploads->OnComplete([allocator, device, buffer, memory]() mutable {
+		vkDestroyBuffer(device, buffer, nullptr);
+		allocator->Free(memory);
+	});
+
+	return allocation;
+}
+
+StagingAllocation StagingBufferPool::Allocate(VkDeviceSize size)
+{
+	//Anything that can never fit in the arena gets a one-off buffer rather than deadlocking the ring.
+	if (size > Budget)
+	{
+		return AllocateDedicated(size);
+	}
+
+	VkDeviceSize offset;
+	VkDeviceSize end;
+	while (!TryAllocate(size, offset, end))
+	{
+		Uploads->Wait(InFlightChunks.front().Token);
+	}
+
+	Head = end;
+	if (InFlightChunks.empty())
+	{
+		Tail = offset;
+	}
+
+	StagingChunk chunk;
+	chunk.Offset = offset;
+	chunk.Token = Uploads->GetRecordingToken();
+	InFlightChunks.push_back(chunk);
+	Uploads->OnComplete([this]() { ReleaseOldest(); });
+
+	StagingAllocation allocation;
+	allocation.Buffer = Buffer;
+	allocation.Offset = offset;
+	allocation.Size = size;
+	allocation.MappedData = static_cast<char*>(BufferMemory.MappedData) + offset;
+	return allocation;
+}
+
+VkDeviceSize StagingBufferPool::GetBytesInFlight()
+{
+	if (InFlightChunks.empty())
+	{
+		return 0;
+	}
+
+	return Head > Tail ? Head - Tail : Budget - Tail + Head;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <deque>
+#include "MemoryAllocator.h"
+#include "UploadContext.h"
+
+struct StagingAllocation
+{
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+	void* MappedData = nullptr;
+};
+
+//A persistently mapped staging arena that hands out linear chunks per upload as a ring.
+//Chunks are recycled when the upload batch that reads them completes; when the budget is exhausted
+//Allocate() blocks on the oldest in-flight batch instead of growing.
+class StagingBufferPool
+{
+private:
+	struct StagingChunk
+	{
+		VkDeviceSize Offset;
+		UploadToken Token;
+	};
+
+	MemoryAllocator* Allocator = nullptr;
+	UploadContext* Uploads = nullptr;
+	VkDevice Device = VK_NULL_HANDLE;
+
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	MemoryAllocation BufferMemory;
+	VkDeviceSize Budget = 0;
+	VkDeviceSize Alignment = 16;
+
+	VkDeviceSize Head = 0;
+	VkDeviceSize Tail = 0;
+	std::deque<StagingChunk> InFlightChunks;
+
+	bool TryAllocate(VkDeviceSize size, VkDeviceSize& offset, VkDeviceSize& end);
+	void ReleaseOldest();
+	StagingAllocation AllocateDedicated(VkDeviceSize size);
+
+public:
+	StagingBufferPool();
+	~StagingBufferPool();
+
+	void Create(MemoryAllocator& allocator, VkDevice device, UploadContext& uploadContext, VkDeviceSize budget, VkDeviceSize alignment);
+	void Destroy();
+
+	StagingAllocation Allocate(VkDeviceSize size);
+
+	VkDeviceSize GetBudget() { return Budget; }
+	VkDeviceSize GetBytesInFlight();
+};
@@ -0,0 +1,921 @@
+#include "TextureLoader.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+static const VkDeviceSize LevelAlignment = 16;
+
+static const uint8_t Ktx2Identifier[12] = { 0xab, 0x4b, 0x54, 0x58, 0x20, 0x32, 0x30, 0xbb, 0x0d, 0x0a, 0x1a, 0x0a };
+static const size_t Ktx2HeaderSize = 80;
+static const size_t Ktx2LevelEntrySize = 24;
+static const uint32_t Ktx2AlphaPremultipliedFlag = 1;
+
+struct FormatInfo
+{
+	VkFormat Format;
+	uint32_t BlockWidth;
+	uint32_t BlockHeight;
+	uint32_t BlockBytes;
+	const char* Name;
+};
+
+static const FormatInfo Formats[] = {
+	{ VK_FORMAT_R8G8B8A8_UNORM, 1, 1, 4, "RGBA8" },
+	{ VK_FORMAT_R8G8B8A8_SRGB, 1, 1, 4, "RGBA8 sRGB" },
+	{ VK_FORMAT_BC1_RGB_UNORM_BLOCK, 4, 4, 8, "BC1 RGB" },
+	{ VK_FORMAT_BC1_RGB_SRGB_BLOCK, 4, 4, 8, "BC1 RGB sRGB" },
+	{ VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 4, 4, 8, "BC1 RGBA" },
+	{ VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 4, 4, 8, "BC1 RGBA sRGB" },
+	{ VK_FORMAT_BC3_UNORM_BLOCK, 4, 4, 16, "BC3" },
+	{ VK_FORMAT_BC3_SRGB_BLOCK, 4, 4, 16, "BC3 sRGB" },
+	{ VK_FORMAT_BC7_UNORM_BLOCK, 4, 4, 16, "BC7" },
+	{ VK_FORMAT_BC7_SRGB_BLOCK, 4, 4, 16, "BC7 sRGB" },
+	{ VK_FORMAT_ASTC_4x4_UNORM_BLOCK, 4, 4, 16, "ASTC 4x4" },
+	{ VK_FORMAT_ASTC_4x4_SRGB_BLOCK, 4, 4, 16, "ASTC 4x4 sRGB" },
+	{ VK_FORMAT_ASTC_5x4_UNORM_BLOCK, 5, 4, 16, "ASTC 5x4" },
+	{ VK_FORMAT_ASTC_5x4_SRGB_BLOCK, 5, 4, 16, "ASTC 5x4 sRGB" },
+	{ VK_FORMAT_ASTC_5x5_UNORM_BLOCK, 5, 5, 16, "ASTC 5x5" },
+	{ VK_FORMAT_ASTC_5x5_SRGB_BLOCK, 5, 5, 16, "ASTC 5x5 sRGB" },
+	{ VK_FORMAT_ASTC_6x5_UNORM_BLOCK, 6, 5, 16, "ASTC 6x5" },
+	{ VK_FORMAT_ASTC_6x5_SRGB_BLOCK, 6, 5, 16, "ASTC 6x5 sRGB" },
+	{ VK_FORMAT_ASTC_6x6_UNORM_BLOCK, 6, 6, 16, "ASTC 6x6" },
+	{ VK_FORMAT_ASTC_6x6_SRGB_BLOCK, 6, 6, 16, "ASTC 6x6 sRGB" },
+	{ VK_FORMAT_ASTC_8x5_UNORM_BLOCK, 8, 5, 16, "ASTC 8x5" },
+	{ VK_FORMAT_ASTC_8x5_SRGB_BLOCK, 8, 5, 16, "ASTC 8x5 sRGB" },
+	{ VK_FORMAT_ASTC_8x6_UNORM_BLOCK, 8, 6, 16, "ASTC 8x6" },
+	{ VK_FORMAT_ASTC_8x6_SRGB_BLOCK, 8, 6, 16, "ASTC 8x6 sRGB" },
+	{ VK_FORMAT_ASTC_8x8_UNORM_BLOCK, 8, 8, 16, "ASTC 8x8" },
+	{ VK_FORMAT_ASTC_8x8_SRGB_BLOCK, 8, 8, 16, "ASTC 8x8 sRGB" },
+	{ VK_FORMAT_ASTC_10x5_UNORM_BLOCK, 10, 5, 16, "ASTC 10x5" },
+	{ VK_FORMAT_ASTC_10x5_SRGB_BLOCK, 10, 5, 16, "ASTC 10x5 sRGB" },
+	{ VK_FORMAT_ASTC_10x6_UNORM_BLOCK, 10, 6, 16, "ASTC 10x6" },
+	{ VK_FORMAT_ASTC_10x6_SRGB_BLOCK, 10, 6, 16, "ASTC 10x6 sRGB" },
+	{ VK_FORMAT_ASTC_10x8_UNORM_BLOCK, 10, 8, 16, "ASTC 10x8" },
+	{ VK_FORMAT_ASTC_10x8_SRGB_BLOCK, 10, 8, 16, "ASTC 10x8 sRGB" },
+	{ VK_FORMAT_ASTC_10x10_UNORM_BLOCK, 10, 10, 16, "ASTC 10x10" },
+	{ VK_FORMAT_ASTC_10x10_SRGB_BLOCK, 10, 10, 16, "ASTC 10x10 sRGB" },
+	{ VK_FORMAT_ASTC_12x10_UNORM_BLOCK, 12, 10, 16, "ASTC 12x10" },
+	{ VK_FORMAT_ASTC_12x10_SRGB_BLOCK, 12, 10, 16, "ASTC 12x10 sRGB" },
+	{ VK_FORMAT_ASTC_12x12_UNORM_BLOCK, 12, 12, 16, "ASTC 12x12" },
+	{ VK_FORMAT_ASTC_12x12_SRGB_BLOCK, 12, 12, 16, "ASTC 12x12 sRGB" }
+};
+
+static const FormatInfo* FindFormat(VkFormat format)
+{
+	for (const auto& info : Formats)
+	{
+		if (info.Format == format)
+		{
+			return &info;
+		}
+	}
+	return nullptr;
+}
+
+template <typename T>
+static T ReadValue(const AssetView& file, size_t offset)
+{
+	if (offset + sizeof(T) > file.Size) {
+		throw std::runtime_error("texture file is truncated!");
+	}
+
+	T value;
+	memcpy(&value, file.Data + offset, sizeof(T));
+	return value;
+}
+
+void TextureLoader::AllocateLevels(TextureData& texture, uint32_t levelCount)
+{
+	const FormatInfo* info = FindFormat(texture.Format);
+	if (info == nullptr) {
+		throw std::runtime_error("unsupported texture format!");
+	}
+
+	texture.Levels.resize(levelCount);
+
+	VkDeviceSize offset = 0;
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		MipLevel& level = texture.Levels[i];
+		level.Width = std::max(texture.Width >> i, 1u);
+		level.Height = std::max(texture.Height >> i, 1u);
+		level.Offset = offset;
+
+		VkDeviceSize blocksWide = (level.Width + info->BlockWidth - 1) / info->BlockWidth;
+		VkDeviceSize blocksHigh = (level.Height + info->BlockHeight - 1) / info->BlockHeight;
+		level.Size = blocksWide * blocksHigh * info->BlockBytes;
+
+		offset = (offset + level.Size + LevelAlignment - 1) / LevelAlignment * LevelAlignment;
+	}
+
+	texture.Data.resize(static_cast<size_t>(offset));
+}
+
+static void CopyLevel(TextureData& texture, uint32_t level, const AssetView& file, uint64_t offset, uint64_t size)
+{
+	if (size < texture.Levels[level].Size || offset + texture.Levels[level].Size > file.Size) {
+		throw std::runtime_error("texture file is truncated!");
+	}
+
+	memcpy(texture.Data.data() + texture.Levels[level].Offset, file.Data + offset, static_cast<size_t>(texture.Levels[level].Size));
+}
+
+//5:6:5 to 8 bits per channel, replicating the high bits into the low ones.
+static void UnpackRgb565(uint16_t color, uint8_t* rgb)
+{
+	uint32_t r = (color >> 11) & 0x1f;
+	uint32_t g = (color >> 5) & 0x3f;
+	uint32_t b = color & 0x1f;
+	rgb[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+	rgb[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+	rgb[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+}
+
+//Decodes the 8 byte colour half of a BC1/BC3 block into 16 RGBA texels. BC3 always uses the four colour mode.
+static void DecodeBc1(const uint8_t* block, uint8_t* texels, bool allowThreeColor, bool transparentBlack)
+{
+	uint16_t color0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+	uint16_t color1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+	uint8_t palette[4][4];
+	UnpackRgb565(color0, palette[0]);
+	UnpackRgb565(color1, palette[1]);
+	palette[0][3] = 255;
+	palette[1][3] = 255;
+
+	for (int c = 0; c < 3; c++)
+	{
+		if (color0 > color1 || !allowThreeColor)
+		{
+			palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+			palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+		}
+		else
+		{
+			palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+			palette[3][c] = 0;
+		}
+	}
+	palette[2][3] = 255;
+	palette[3][3] = (color0 > color1 || !allowThreeColor || !transparentBlack) ? 255 : 0;
+
+	uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+	for (int i = 0; i < 16; i++)
+	{
+		memcpy(texels + i * 4, palette[(indices >> (2 * i)) & 3], 4);
+	}
+}
+
+static void DecodeBc3Alpha(const uint8_t* block, uint8_t* texels)
+{
+	uint8_t palette[8];
+	palette[0] = block[0];
+	palette[1] = block[1];
+	if (palette[0] > palette[1])
+	{
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = static_cast<uint8_t>(((7 - i) * palette[0] + i * palette[1]) / 7);
+		}
+	}
+	else
+	{
+		for (int i = 1; i < 5; i++)
+		{
+			palette[i + 1] = static_cast<uint8_t>(((5 - i) * palette[0] + i * palette[1]) / 5);
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = 0;
+	for (int i = 0; i < 6; i++)
+	{
+		indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+	}
+	for (int i = 0; i < 16; i++)
+	{
+		texels[i * 4 + 3] = palette[(indices >> (3 * i)) & 7];
+	}
+}
+
+//BC7 tables from the D3D11 functional specification.
+struct Bc7ModeInfo
+{
+	uint32_t SubsetCount;
+	uint32_t PartitionBits;
+	uint32_t RotationBits;
+	uint32_t IndexSelectionBits;
+	uint32_t ColorBits;
+	uint32_t AlphaBits;
+	uint32_t EndpointPBits;
+	uint32_t SharedPBits;
+	uint32_t IndexBits;
+	uint32_t SecondaryIndexBits;
+};
+
+static const Bc7ModeInfo Bc7Modes[8] = {
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+//Bit i is the subset of texel i.
+static const uint16_t Bc7Partitions2[64] = {
+	0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+	0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+	0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+	0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+	0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+	0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+	0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+	0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+};
+
+static const uint8_t Bc7Partitions3[64][16] = {
+	{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+	{ 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 }, { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 }, { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+	{ 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 }, { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+	{ 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+	{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 }, { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+	{ 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+	{ 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 }, { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+	{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 }, { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+	{ 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 }, { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+	{ 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 }, { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+	{ 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 }, { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 }, { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 }, { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+	{ 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 }, { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 }, { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 }, { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+	{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 }, { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+	{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 }, { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+	{ 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 }, { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+	{ 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 }, { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+	{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 }, { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+	{ 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+	{ 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 }, { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+	{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+};
+
+static const uint8_t Bc7Anchors2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+	15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+	6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+};
+
+static const uint8_t Bc7Anchors3Second[64] = {
+	3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+	3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+	8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+	3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3
+};
+
+static const uint8_t Bc7Anchors3Third[64] = {
+	15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+	15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+	15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+	15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8
+};
+
+static const uint8_t Bc7Weights2[4] = { 0, 21, 43, 64 };
+static const uint8_t Bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const uint8_t Bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+class BlockBitReader
+{
+private:
+	const uint8_t* Block;
+	uint32_t Position = 0;
+
+public:
+	BlockBitReader(const uint8_t* block) : Block(block) {}
+
+	uint32_t Read(uint32_t count)
+	{
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < count; i++, Position++)
+		{
+			value |= ((Block[Position >> 3] >> (Position & 7)) & 1u) << i;
+		}
+		return value;
+	}
+};
+
+static const uint8_t* Bc7WeightTable(uint32_t indexBits)
+{
+	return indexBits == 2 ? Bc7Weights2 : (indexBits == 3 ? Bc7Weights3 : Bc7Weights4);
+}
+
+static uint8_t Bc7Interpolate(uint32_t e0, uint32_t e1, uint32_t weight)
+{
+	return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+static void DecodeBc7(const uint8_t* block, uint8_t* texels)
+{
+	uint32_t mode = 0;
+	while (mode < 8 && (block[0] & (1u << mode)) == 0)
+	{
+		mode++;
+	}
+
+	//Reserved mode: the specification decodes it to transparent black.
+	if (mode == 8)
+	{
+		memset(texels, 0, 64);
+		return;
+	}
+
+	const Bc7ModeInfo& info = Bc7Modes[mode];
+	BlockBitReader reader(block);
+	reader.Read(mode + 1);
+
+	uint32_t partition = reader.Read(info.PartitionBits);
+	uint32_t rotation = reader.Read(info.RotationBits);
+	uint32_t indexSelection = reader.Read(info.IndexSelectionBits);
+
+	uint32_t endpoints[3][2][4] = {};
+	for (uint32_t channel = 0; channel < 3; channel++)
+	{
+		for (uint32_t subset = 0; subset < info.SubsetCount; subset++)
+		{
+			endpoints[subset][0][channel] = reader.Read(info.ColorBits);
+			endpoints[subset][1][channel] = reader.Read(info.ColorBits);
+		}
+	}
+	if (info.AlphaBits > 0)
+	{
+		for (uint32_t subset = 0; subset < info.SubsetCount; subset++)
+		{
+			endpoints[subset][0][3] = reader.Read(info.AlphaBits);
+			endpoints[subset][1][3] = reader.Read(info.AlphaBits);
+		}
+	}
+
+	uint32_t pBits[3][2] = {};
+	bool hasPBits = info.EndpointPBits > 0 || info.SharedPBits > 0;
+	for (uint32_t subset = 0; subset < info.SubsetCount; subset++)
+	{
+		if (info.EndpointPBits > 0)
+		{
+			pBits[subset][0] = reader.Read(1);
+			pBits[subset][1] = reader.Read(1);
+		}
+		else if (info.SharedPBits > 0)
+		{
+			pBits[subset][0] = pBits[subset][1] = reader.Read(1);
+		}
+	}
+
+	//Append the p-bit and widen every endpoint to 8 bits by replicating its top bits.
+	for (uint32_t subset = 0; subset < info.SubsetCount; subset++)
+	{
+		for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+		{
+			for (uint32_t channel = 0; channel < 4; channel++)
+			{
+				uint32_t bits = channel < 3 ? info.ColorBits : info.AlphaBits;
+				if (bits == 0)
+				{
+					endpoints[subset][endpoint][channel] = 255;
+					continue;
+				}
+
+				uint32_t value = endpoints[subset][endpoint][channel];
+				if (hasPBits)
+				{
+					value = (value << 1) | pBits[subset][endpoint];
+					bits++;
+				}
+				value <<= 8 - bits;
+				endpoints[subset][endpoint][channel] = value | (value >> bits);
+			}
+		}
+	}
+
+	uint32_t subsets[16];
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		subsets[i] = info.SubsetCount == 1 ? 0 : (info.SubsetCount == 2 ? (Bc7Partitions2[partition] >> i) & 1 : Bc7Partitions3[partition][i]);
+	}
+
+	//Anchor texels store their index with the top bit dropped.
+	auto isAnchor = [&](uint32_t texel) {
+		if (texel == 0)
+		{
+			return true;
+		}
+		if (info.SubsetCount == 2)
+		{
+			return texel == Bc7Anchors2[partition];
+		}
+		if (info.SubsetCount == 3)
+		{
+			return texel == Bc7Anchors3Second[partition] || texel == Bc7Anchors3Third[partition];
+		}
+		return false;
+	};
+
+	uint32_t primaryIndices[16];
+	uint32_t secondaryIndices[16] = {};
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		primaryIndices[i] = reader.Read(info.IndexBits - (isAnchor(i) ? 1 : 0));
+	}
+	if (info.SecondaryIndexBits > 0)
+	{
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			secondaryIndices[i] = reader.Read(info.SecondaryIndexBits - (i == 0 ? 1 : 0));
+		}
+	}
+
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		const uint32_t* e0 = endpoints[subsets[i]][0];
+		const uint32_t* e1 = endpoints[subsets[i]][1];
+
+		uint32_t colorWeight;
+		uint32_t alphaWeight;
+		if (info.SecondaryIndexBits == 0)
+		{
+			colorWeight = alphaWeight = Bc7WeightTable(info.IndexBits)[primaryIndices[i]];
+		}
+		else if (indexSelection == 0)
+		{
+			colorWeight = Bc7WeightTable(info.IndexBits)[primaryIndices[i]];
+			alphaWeight = Bc7WeightTable(info.SecondaryIndexBits)[secondaryIndices[i]];
+		}
+		else
+		{
+			colorWeight = Bc7WeightTable(info.SecondaryIndexBits)[secondaryIndices[i]];
+			alphaWeight = Bc7WeightTable(info.IndexBits)[primaryIndices[i]];
+		}
+
+		uint8_t* texel = texels + i * 4;
+		for (uint32_t channel = 0; channel < 3; channel++)
+		{
+			texel[channel] = Bc7Interpolate(e0[channel], e1[channel], colorWeight);
+		}
+		texel[3] = Bc7Interpolate(e0[3], e1[3], alphaWeight);
+
+		if (rotation > 0)
+		{
+			std::swap(texel[3], texel[rotation - 1]);
+		}
+	}
+}
+
+bool TextureData::IsCompressed() const
+{
+	const FormatInfo* info = FindFormat(Format);
+	return info != nullptr && info->BlockWidth > 1;
+}
+
+bool TextureLoader::IsContainer(const std::string& path)
+{
+	auto endsWith = [&path](const std::string& suffix) {
+		if (path.size() < suffix.size())
+		{
+			return false;
+		}
+		return std::equal(suffix.rbegin(), suffix.rend(), path.rbegin(), [](char a, char b) { return a == tolower(static_cast<unsigned char>(b)); });
+	};
+	return endsWith(".ktx2") || endsWith(".dds");
+}
+
+TextureData TextureLoader::Load(const AssetView& file, const std::string& name)
+{
+	if (file.Size >= 4 && memcmp(file.Data, "DDS ", 4) == 0)
+	{
+		return LoadDds(file, name);
+	}
+	return LoadKtx2(file, name);
+}
+
+TextureData TextureLoader::LoadKtx2(const AssetView& file, const std::string& name)
+{
+	if (file.Size < Ktx2HeaderSize || memcmp(file.Data, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0) {
+		throw std::runtime_error("not a KTX2 file: " + name);
+	}
+
+	//Header fields follow the 12 byte identifier; the level index starts at byte 80.
+	uint32_t vkFormat = ReadValue<uint32_t>(file, 12);
+	uint32_t width = ReadValue<uint32_t>(file, 20);
+	uint32_t height = ReadValue<uint32_t>(file, 24);
+	uint32_t depth = ReadValue<uint32_t>(file, 28);
+	uint32_t layerCount = ReadValue<uint32_t>(file, 32);
+	uint32_t faceCount = ReadValue<uint32_t>(file, 36);
+	uint32_t levelCount = std::max(ReadValue<uint32_t>(file, 40), 1u);
+	uint32_t supercompression = ReadValue<uint32_t>(file, 44);
+	uint32_t dfdByteOffset = ReadValue<uint32_t>(file, 48);
+	uint32_t dfdByteLength = ReadValue<uint32_t>(file, 52);
+
+	if (vkFormat == 0 || supercompression != 0) {
+		throw std::runtime_error("supercompressed KTX2 textures are not supported: " + name);
+	}
+	if (depth > 1 || layerCount > 1 || faceCount != 1 || height == 0) {
+		throw std::runtime_error("only 2D KTX2 textures are supported: " + name);
+	}
+	//More levels than the full chain would reach vkCreateImage as an invalid mipLevels.
+	if (width == 0 || levelCount > MipmapGenerator::GetMipLevelCount(width, height)) {
+		throw std::runtime_error("invalid KTX2 size or level count: " + name);
+	}
+	if (Ktx2HeaderSize + static_cast<uint64_t>(levelCount) * Ktx2LevelEntrySize > file.Size) {
+		throw std::runtime_error("texture file is truncated!");
+	}
+
+	TextureData texture;
+	texture.Format = static_cast<VkFormat>(vkFormat);
+	texture.Width = width;
+	texture.Height = height;
+	AllocateLevels(texture, levelCount);
+
+	//The flags byte of the basic descriptor block sits 4 bytes (total size) + 8 bytes (block header) + 3 bytes in.
+	if (dfdByteLength >= 16)
+	{
+		texture.Premultiplied = (ReadValue<uint8_t>(file, dfdByteOffset + 15) & Ktx2AlphaPremultipliedFlag) != 0;
+	}
+
+	//Each level is copied once, out of the mapped file into its final place in Data.
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		size_t entry = Ktx2HeaderSize + i * Ktx2LevelEntrySize;
+		CopyLevel(texture, i, file, ReadValue<uint64_t>(file, entry), ReadValue<uint64_t>(file, entry + 8));
+	}
+
+	return texture;
+}
+
+//Builds the basic data format descriptor KTX2 requires: the colour model, transfer function and premultiplied flag,
+//plus one sample per channel for RGBA8 or per compressed plane for the block formats.
+static std::vector<uint8_t> BuildDataFormatDescriptor(const FormatInfo& info, bool premultiplied)
+{
+	static const uint32_t ModelRgbsda = 1;
+	static const uint32_t ModelBc1a = 128;
+	static const uint32_t ModelBc3 = 130;
+	static const uint32_t ModelBc7 = 134;
+	static const uint32_t ModelAstc = 162;
+	static const uint32_t PrimariesBt709 = 1;
+	static const uint32_t TransferLinear = 1;
+	static const uint32_t TransferSrgb = 2;
+	static const uint32_t ChannelAlpha = 15;
+	static const uint32_t QualifierLinear = 0x10;
+
+	struct Sample
+	{
+		uint32_t BitOffset;
+		uint32_t BitLength;
+		uint32_t Channel;
+		uint32_t Upper;
+	};
+
+	bool srgb = strstr(info.Name, "sRGB") != nullptr;
+	uint32_t model;
+	std::vector<Sample> samples;
+
+	switch (info.Format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		model = ModelRgbsda;
+		samples = { { 0, 8, 0, 255 }, { 8, 8, 1, 255 }, { 16, 8, 2, 255 }, { 24, 8, ChannelAlpha | (srgb ? QualifierLinear : 0), 255 } };
+		break;
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		model = ModelBc1a;
+		samples = { { 0, 64, 0, UINT32_MAX } };
+		break;
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		model = ModelBc1a;
+		samples = { { 0, 64, 1, UINT32_MAX } };
+		break;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		model = ModelBc3;
+		samples = { { 0, 64, ChannelAlpha | (srgb ? QualifierLinear : 0), UINT32_MAX }, { 64, 64, 0, UINT32_MAX } };
+		break;
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		model = ModelBc7;
+		samples = { { 0, 128, 0, UINT32_MAX } };
+		break;
+	default:
+		model = ModelAstc;
+		samples = { { 0, 128, 0, UINT32_MAX } };
+		break;
+	}
+
+	uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+	std::vector<uint32_t> words;
+	words.push_back(4 + blockSize);
+	words.push_back(0);
+	words.push_back(2 | (blockSize << 16));
+	words.push_back(model | (PrimariesBt709 << 8) | ((srgb ? TransferSrgb : TransferLinear) << 16) | ((premultiplied ? Ktx2AlphaPremultipliedFlag : 0) << 24));
+	words.push_back((info.BlockWidth - 1) | ((info.BlockHeight - 1) << 8));
+	words.push_back(info.BlockBytes);
+	words.push_back(0);
+	for (const auto& sample : samples)
+	{
+		words.push_back(sample.BitOffset | ((sample.BitLength - 1) << 16) | (sample.Channel << 24));
+		words.push_back(0);
+		words.push_back(0);
+		words.push_back(sample.Upper);
+	}
+
+	std::vector<uint8_t> descriptor(words.size() * sizeof(uint32_t));
+	memcpy(descriptor.data(), words.data(), descriptor.size());
+	return descriptor;
+}
+
+void TextureLoader::SaveKtx2(const std::string& path, const TextureData& texture)
+{
+	const FormatInfo* info = FindFormat(texture.Format);
+	if (info == nullptr) {
+		throw std::runtime_error("unsupported texture format!");
+	}
+
+	std::vector<uint8_t> descriptor = BuildDataFormatDescriptor(*info, texture.Premultiplied);
+	uint32_t levelCount = static_cast<uint32_t>(texture.Levels.size());
+
+	//Level data is stored smallest level first, each level aligned to lcm(block size, 4).
+	uint64_t levelAlignment = info->BlockBytes % 4 == 0 ? info->BlockBytes : info->BlockBytes * 4;
+	uint64_t dfdOffset = Ktx2HeaderSize + levelCount * Ktx2LevelEntrySize;
+	uint64_t offset = dfdOffset + descriptor.size();
+
+	std::vector<uint64_t> levelOffsets(levelCount);
+	for (uint32_t i = levelCount; i-- > 0;)
+	{
+		offset = (offset + levelAlignment - 1) / levelAlignment * levelAlignment;
+		levelOffsets[i] = offset;
+		offset += texture.Levels[i].Size;
+	}
+
+	std::vector<uint8_t> file(static_cast<size_t>(offset));
+	auto write = [&file](size_t position, auto value) {
+		memcpy(file.data() + position, &value, sizeof(value));
+	};
+
+	memcpy(file.data(), Ktx2Identifier, sizeof(Ktx2Identifier));
+	write(12, static_cast<uint32_t>(texture.Format));
+	write(16, 1u);
+	write(20, texture.Width);
+	write(24, texture.Height);
+	write(28, 0u);
+	write(32, 0u);
+	write(36, 1u);
+	write(40, levelCount);
+	write(44, 0u);
+	write(48, static_cast<uint32_t>(dfdOffset));
+	write(52, static_cast<uint32_t>(descriptor.size()));
+	write(56, 0u);
+	write(60, 0u);
+	write(64, uint64_t(0));
+	write(72, uint64_t(0));
+
+	for (uint32_t i = 0; i < levelCount; i++)
+	{
+		size_t entry = Ktx2HeaderSize + i * Ktx2LevelEntrySize;
+		write(entry, levelOffsets[i]);
+		write(entry + 8, static_cast<uint64_t>(texture.Levels[i].Size));
+		write(entry + 16, static_cast<uint64_t>(texture.Levels[i].Size));
+		memcpy(file.data() + levelOffsets[i], texture.Data.data() + texture.Levels[i].Offset, static_cast<size_t>(texture.Levels[i].Size));
+	}
+	memcpy(file.data() + dfdOffset, descriptor.data(), descriptor.size());
+
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out.write(reinterpret_cast<const char*>(file.data()), file.size());
+	if (!out) {
+		throw std::runtime_error("failed to write texture " + path + "!");
+	}
+}
+
+TextureData TextureLoader::LoadDds(const AssetView& file, const std::string& name)
+{
+	static const uint32_t HeaderOffset = 4;
+	static const uint32_t MipMapCountFlag = 0x20000;
+	static const uint32_t FourCCFlag = 0x4;
+	static const uint32_t CubemapFlag = 0x200;
+	static const uint32_t VolumeFlag = 0x200000;
+
+	if (file.Size < HeaderOffset + 124 || memcmp(file.Data, "DDS ", 4) != 0) {
+		throw std::runtime_error("not a DDS file: " + name);
+	}
+
+	uint32_t flags = ReadValue<uint32_t>(file, HeaderOffset + 4);
+	uint32_t height = ReadValue<uint32_t>(file, HeaderOffset + 8);
+	uint32_t width = ReadValue<uint32_t>(file, HeaderOffset + 12);
+	uint32_t mipMapCount = ReadValue<uint32_t>(file, HeaderOffset + 24);
+	uint32_t pixelFormatFlags = ReadValue<uint32_t>(file, HeaderOffset + 76);
+	uint32_t fourCC = ReadValue<uint32_t>(file, HeaderOffset + 80);
+	uint32_t rgbBitCount = ReadValue<uint32_t>(file, HeaderOffset + 84);
+	uint32_t redMask = ReadValue<uint32_t>(file, HeaderOffset + 88);
+	uint32_t caps2 = ReadValue<uint32_t>(file, HeaderOffset + 112);
+
+	if (caps2 & (CubemapFlag | VolumeFlag)) {
+		throw std::runtime_error("only 2D DDS textures are supported: " + name);
+	}
+
+	uint32_t levelCount = (flags & MipMapCountFlag) ? std::max(mipMapCount, 1u) : 1;
+	if (width == 0 || height == 0 || levelCount > MipmapGenerator::GetMipLevelCount(width, height)) {
+		throw std::runtime_error("invalid DDS size or mip count: " + name);
+	}
+
+	auto makeFourCC = [](const char* code) {
+		return static_cast<uint32_t>(code[0]) | (static_cast<uint32_t>(code[1]) << 8) | (static_cast<uint32_t>(code[2]) << 16) | (static_cast<uint32_t>(code[3]) << 24);
+	};
+
+	TextureData texture;
+	size_t dataOffset = HeaderOffset + 124;
+
+	if ((pixelFormatFlags & FourCCFlag) && fourCC == makeFourCC("DX10"))
+	{
+		uint32_t dxgiFormat = ReadValue<uint32_t>(file, dataOffset);
+		uint32_t arraySize = ReadValue<uint32_t>(file, dataOffset + 12);
+		dataOffset += 20;
+
+		if (arraySize > 1) {
+			throw std::runtime_error("DDS texture arrays are not supported: " + name);
+		}
+
+		switch (dxgiFormat)
+		{
+		case 28: texture.Format = VK_FORMAT_R8G8B8A8_UNORM; break;
+		case 29: texture.Format = VK_FORMAT_R8G8B8A8_SRGB; break;
+		case 71: texture.Format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+		case 72: texture.Format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK; break;
+		case 77: texture.Format = VK_FORMAT_BC3_UNORM_BLOCK; break;
+		case 78: texture.Format = VK_FORMAT_BC3_SRGB_BLOCK; break;
+		case 98: texture.Format = VK_FORMAT_BC7_UNORM_BLOCK; break;
+		case 99: texture.Format = VK_FORMAT_BC7_SRGB_BLOCK; break;
+		default:
+			throw std::runtime_error("unsupported DXGI format in " + name);
+		}
+	}
+	else if (pixelFormatFlags & FourCCFlag)
+	{
+		if (fourCC == makeFourCC("DXT1")) {
+			texture.Format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		}
+		else if (fourCC == makeFourCC("DXT5")) {
+			texture.Format = VK_FORMAT_BC3_UNORM_BLOCK;
+		}
+		else {
+			throw std::runtime_error("unsupported DDS FourCC in " + name);
+		}
+	}
+	else if (rgbBitCount == 32 && redMask == 0x000000ff)
+	{
+		texture.Format = VK_FORMAT_R8G8B8A8_UNORM;
+	}
+	else
+	{
+		throw std::runtime_error("unsupported DDS pixel format in " + name);
+	}
+
+	texture.Width = width;
+	texture.Height = height;
+	AllocateLevels(texture, levelCount);
+
+	//DDS stores the levels back to back, largest first.
+	for (uint32_t i = 0; i < texture.Levels.size(); i++)
+	{
+		size_t size = static_cast<size_t>(texture.Levels[i].Size);
+		CopyLevel(texture, i, file, dataOffset, size);
+		dataOffset += size;
+	}
+
+	return texture;
+}
+
+bool TextureLoader::IsFormatSupported(VkPhysicalDevice physicalDevice, VkFormat format)
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (properties.optimalTilingFeatures & required) == required;
+}
+
+bool TextureLoader::CanDecompress(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+		return true;
+	default:
+		return false;
+	}
+}
+
+TextureData TextureLoader::Decompress(const TextureData& texture)
+{
+	if (!CanDecompress(texture.Format)) {
+		throw std::runtime_error(std::string("no CPU decoder for ") + GetFormatName(texture.Format) + " textures!");
+	}
+
+	bool srgb = texture.Format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || texture.Format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+		texture.Format == VK_FORMAT_BC3_SRGB_BLOCK || texture.Format == VK_FORMAT_BC7_SRGB_BLOCK;
+	uint32_t blockBytes = (texture.Format == VK_FORMAT_BC3_UNORM_BLOCK || texture.Format == VK_FORMAT_BC3_SRGB_BLOCK ||
+		texture.Format == VK_FORMAT_BC7_UNORM_BLOCK || texture.Format == VK_FORMAT_BC7_SRGB_BLOCK) ? 16 : 8;
+
+	TextureData decoded;
+	decoded.Format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+	decoded.Width = texture.Width;
+	decoded.Height = texture.Height;
+	decoded.Premultiplied = texture.Premultiplied;
+	AllocateLevels(decoded, static_cast<uint32_t>(texture.Levels.size()));
+
+	uint8_t texels[64];
+	for (size_t i = 0; i < texture.Levels.size(); i++)
+	{
+		const MipLevel& source = texture.Levels[i];
+		const MipLevel& destination = decoded.Levels[i];
+		uint32_t blocksWide = (source.Width + 3) / 4;
+		uint32_t blocksHigh = (source.Height + 3) / 4;
+
+		for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+		{
+			for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+			{
+				const uint8_t* block = texture.Data.data() + source.Offset + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes;
+
+				switch (texture.Format)
+				{
+				case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+				case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+					DecodeBc1(block, texels, true, false);
+					break;
+				case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+				case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+					DecodeBc1(block, texels, true, true);
+					break;
+				case VK_FORMAT_BC3_UNORM_BLOCK:
+				case VK_FORMAT_BC3_SRGB_BLOCK:
+					DecodeBc1(block + 8, texels, false, false);
+					DecodeBc3Alpha(block, texels);
+					break;
+				default:
+					DecodeBc7(block, texels);
+					break;
+				}
+
+				//Blocks on the right and bottom edges of non multiple of four levels are clipped.
+				for (uint32_t y = 0; y < 4 && blockY * 4 + y < destination.Height; y++)
+				{
+					uint32_t columns = std::min(4u, destination.Width - blockX * 4);
+					uint8_t* row = decoded.Data.data() + destination.Offset + ((static_cast<size_t>(blockY) * 4 + y) * destination.Width + blockX * 4) * 4;
+					memcpy(row, texels + y * 16, columns * 4);
+				}
+			}
+		}
+	}
+
+	return decoded;
+}
+
+bool TextureLoader::GetBlockInfo(VkFormat format, uint32_t& blockWidth, uint32_t& blockHeight, uint32_t& blockBytes)
+{
+	const FormatInfo* info = FindFormat(format);
+	if (info == nullptr)
+	{
+		return false;
+	}
+
+	blockWidth = info->BlockWidth;
+	blockHeight = info->BlockHeight;
+	blockBytes = info->BlockBytes;
+	return true;
+}
+
+const char* TextureLoader::GetFormatName(VkFormat format)
+{
+	const FormatInfo* info = FindFormat(format);
+	return info != nullptr ? info->Name : "unknown format";
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <string>
+#include "MipmapGenerator.h"
+#include "AssetReader.h"
+
+//A texture as stored in its container: every mip level packed into Data, each level starting on a 16 byte boundary
+//so it can be copied straight out of a staging buffer.
+struct TextureData
+{
+	VkFormat Format = VK_FORMAT_UNDEFINED;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	std::vector<MipLevel> Levels;
+	std::vector<uint8_t> Data;
+	//Colour channels already multiplied by alpha; recorded in the KTX2 data format descriptor.
+	bool Premultiplied = false;
+
+	bool IsCompressed() const;
+};
+
+//Reads pre-compressed mip chains from KTX2 and DDS files. BC1, BC3, BC7 and every ASTC block size are passed through to
+//the GPU as is when the device can sample them; BC1, BC3 and BC7 can otherwise be decompressed to RGBA8 on the CPU.
+//Supercompressed KTX2 (Basis, zstd), arrays, cubemaps and 3D textures are rejected.
+class TextureLoader
+{
+public:
+	//True for the .ktx2 and .dds extensions; anything else is left to stb_image.
+	static bool IsContainer(const std::string& path);
+
+	//Parses a mapped file or archive entry; name is only used in error messages.
+	static TextureData Load(const AssetView& file, const std::string& name);
+	static TextureData LoadKtx2(const AssetView& file, const std::string& name);
+	static TextureData LoadDds(const AssetView& file, const std::string& name);
+	//Writes a KTX2 file without supercompression, with a basic data format descriptor and the levels smallest first.
+	static void SaveKtx2(const std::string& path, const TextureData& texture);
+
+	//Whether optimal tiled images of the format can be sampled with linear filtering.
+	static bool IsFormatSupported(VkPhysicalDevice physicalDevice, VkFormat format);
+	static bool CanDecompress(VkFormat format);
+	//Returns the texture as R8G8B8A8 (SRGB when the source is), keeping every level. Throws if CanDecompress() is false.
+	static TextureData Decompress(const TextureData& texture);
+
+	//Lays out the level table for a chain of levelCount levels of texture's format and size, and sizes Data to hold it.
+	static void AllocateLevels(TextureData& texture, uint32_t levelCount);
+
+	//Uncompressed formats report a 1x1 block.
+	static bool GetBlockInfo(VkFormat format, uint32_t& blockWidth, uint32_t& blockHeight, uint32_t& blockBytes);
+	static const char* GetFormatName(VkFormat format);
+};
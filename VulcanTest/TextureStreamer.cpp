@@ -0,0 +1,574 @@
+#include "TextureStreamer.h"
+#include "MipmapGenerator.h"
+#include "BufferManager.h"
+#include "Profiler.h"
+#include <stb_image.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+static const VkDeviceSize StagingLevelAlignment = 16;
+
+TextureStreamer::TextureStreamer()
+{
+}
+
+TextureStreamer::~TextureStreamer()
+{
+}
+
+void TextureStreamer::Create(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, StagingBufferPool& staging, UploadContext& uploads,
+	BindlessTextures& bindless, const AssetReader& assets, VkSampler sampler, uint32_t threadCount, VkDeviceSize uploadBudgetPerFrame)
+{
+	PhysicalDevice = physicalDevice;
+	Device = device;
+	Allocator = &allocator;
+	Staging = &staging;
+	Uploads = &uploads;
+	Bindless = &bindless;
+	Assets = &assets;
+	Sampler = sampler;
+	UploadBudget = uploadBudgetPerFrame;
+	Stopping = false;
+
+	//A mid grey texel stands in for every texture that has nothing resident yet.
+	auto placeholderData = std::make_shared<TextureData>();
+	placeholderData->Format = VK_FORMAT_R8G8B8A8_UNORM;
+	placeholderData->Width = 1;
+	placeholderData->Height = 1;
+	TextureLoader::AllocateLevels(*placeholderData, 1);
+	memset(placeholderData->Data.data(), 128, 3);
+	placeholderData->Data[3] = 255;
+
+	Placeholder.Data = placeholderData;
+	CreateImage(Placeholder);
+	RecordUpload(Placeholder, 0);
+	Placeholder.ResidentLevel = 0;
+	Placeholder.Data.reset();
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = Placeholder.Image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	if (vkCreateImageView(Device, &viewInfo, nullptr, &Placeholder.View) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create placeholder texture view!");
+	}
+	Placeholder.Slot = Bindless->Add(Placeholder.View, Sampler);
+
+	//A handle never needs more than one slot at a time, so the table can be sized to the bindless array.
+	MaxTextures = Bindless->GetCapacity();
+	BufferManager::CreateBuffer(*Allocator, Device, MaxTextures * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, SlotTableBuffer, SlotTableMemory);
+
+	for (uint32_t i = 0; i < std::max(threadCount, 1u); i++)
+	{
+		Workers.emplace_back(&TextureStreamer::WorkerLoop, this);
+	}
+}
+
+void TextureStreamer::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		Stopping = true;
+		DecodeQueue.clear();
+	}
+	WorkAvailable.notify_all();
+	for (auto& worker : Workers)
+	{
+		worker.join();
+	}
+	Workers.clear();
+	DecodeResults.clear();
+
+	//Let pending uploads finish so their completion callbacks run while the textures still exist.
+	Uploads->WaitIdle();
+
+	for (auto& retired : RetiredViews)
+	{
+		vkDestroyImageView(Device, retired.View, nullptr);
+	}
+	RetiredViews.clear();
+
+	Textures.push_back(Placeholder);
+	for (auto& texture : Textures)
+	{
+		if (texture.View != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(Device, texture.View, nullptr);
+		}
+		if (texture.Image != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(Device, texture.Image, nullptr);
+			Allocator->Free(texture.ImageMemory);
+		}
+	}
+	Textures.clear();
+	Placeholder = StreamedTexture();
+
+	vkDestroyBuffer(Device, SlotTableBuffer, nullptr);
+	Allocator->Free(SlotTableMemory);
+	SlotTableBuffer = VK_NULL_HANDLE;
+	TableSlots.clear();
+}
+
+TextureHandle TextureStreamer::Request(const std::string& path)
+{
+	TextureHandle handle = static_cast<TextureHandle>(Textures.size());
+	if (handle >= MaxTextures) {
+		throw std::runtime_error("too many streamed textures!");
+	}
+
+	StreamedTexture texture;
+	texture.Path = path;
+	Textures.push_back(texture);
+
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		DecodeQueue.push_back({ handle, path, 0.0f });
+	}
+	WorkAvailable.notify_one();
+
+	return handle;
+}
+
+void TextureStreamer::SetScreenSize(TextureHandle handle, float pixels)
+{
+	Textures[handle].ScreenSize = pixels;
+
+	std::lock_guard<std::mutex> lock(Mutex);
+	for (auto& job : DecodeQueue)
+	{
+		if (job.Handle == handle)
+		{
+			job.ScreenSize = pixels;
+		}
+	}
+}
+
+bool TextureStreamer::IsIdle() const
+{
+	for (const auto& texture : Textures)
+	{
+		if (texture.Failed)
+		{
+			continue;
+		}
+		if (texture.Image == VK_NULL_HANDLE || texture.ResidentLevel != texture.UploadingLevel ||
+			(texture.Data && GetNextLevel(texture) < texture.UploadingLevel))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+uint32_t TextureStreamer::GetSlot(TextureHandle handle) const
+{
+	const StreamedTexture& texture = Textures[handle];
+	return texture.View != VK_NULL_HANDLE ? texture.Slot : Placeholder.Slot;
+}
+
+bool TextureStreamer::RecordSlotTableUpdate(VkCommandBuffer commandBuffer, VkPipelineStageFlags readStages)
+{
+	TableSlots.resize(Textures.size(), UINT32_MAX);
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = SlotTableBuffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	//Frames still in flight read the table before this barrier, so they keep sampling the slots they were recorded with.
+	bool changed = false;
+	for (TextureHandle handle = 0; handle < Textures.size(); handle++)
+	{
+		uint32_t slot = GetSlot(handle);
+		if (slot == TableSlots[handle])
+		{
+			continue;
+		}
+
+		if (!changed)
+		{
+			vkCmdPipelineBarrier(commandBuffer, readStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+			changed = true;
+		}
+		vkCmdUpdateBuffer(commandBuffer, SlotTableBuffer, handle * sizeof(uint32_t), sizeof(uint32_t), &slot);
+		TableSlots[handle] = slot;
+	}
+
+	if (changed)
+	{
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+	return changed;
+}
+
+void TextureStreamer::WorkerLoop()
+{
+	PROFILE_THREAD("texture decode");
+
+	while (true)
+	{
+		DecodeJob job;
+		{
+			std::unique_lock<std::mutex> lock(Mutex);
+			WorkAvailable.wait(lock, [this]() { return Stopping || !DecodeQueue.empty(); });
+			if (Stopping)
+			{
+				return;
+			}
+
+			auto next = std::max_element(DecodeQueue.begin(), DecodeQueue.end(),
+				[](const DecodeJob& a, const DecodeJob& b) { return a.ScreenSize < b.ScreenSize; });
+			job = *next;
+			DecodeQueue.erase(next);
+		}
+
+		DecodeResult result;
+		result.Handle = job.Handle;
+		try {
+			result.Data = Decode(job.Path);
+		}
+		catch (const std::exception& e) {
+			result.Error = e.what();
+		}
+
+		std::lock_guard<std::mutex> lock(Mutex);
+		DecodeResults.push_back(std::move(result));
+	}
+}
+
+std::shared_ptr<TextureData> TextureStreamer::Decode(const std::string& path)
+{
+	PROFILE_FUNCTION();
+	std::string sourcePath = path;
+	std::string bakedPath = path.substr(0, path.find_last_of('.')) + ".ktx2";
+	if (!TextureLoader::IsContainer(path) && Assets->Exists(bakedPath))
+	{
+		sourcePath = bakedPath;
+	}
+
+	auto texture = std::make_shared<TextureData>();
+	AssetView file = Assets->Read(sourcePath);
+
+	if (TextureLoader::IsContainer(sourcePath))
+	{
+		*texture = TextureLoader::Load(file, sourcePath);
+		if (!TextureLoader::IsFormatSupported(PhysicalDevice, texture->Format))
+		{
+			if (!TextureLoader::CanDecompress(texture->Format)) {
+				throw std::runtime_error(std::string("device cannot sample ") + TextureLoader::GetFormatName(texture->Format) + " textures: " + sourcePath);
+			}
+			*texture = TextureLoader::Decompress(*texture);
+		}
+		if (texture->IsCompressed() || texture->Levels.size() > 1)
+		{
+			return texture;
+		}
+	}
+	else
+	{
+		int texWidth, texHeight, texChannels;
+		stbi_uc* pixels = stbi_load_from_memory(file.Data, static_cast<int>(file.Size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+		if (!pixels) {
+			throw std::runtime_error("failed to load texture image " + sourcePath + "!");
+		}
+
+		texture->Format = VK_FORMAT_R8G8B8A8_UNORM;
+		texture->Width = static_cast<uint32_t>(texWidth);
+		texture->Height = static_cast<uint32_t>(texHeight);
+		texture->Data.assign(pixels, pixels + static_cast<size_t>(texWidth) * texHeight * 4);
+		stbi_image_free(pixels);
+	}
+
+	//Single level RGBA8 sources get their chain here, on the worker, rather than with blits on the render thread.
+	uint32_t mipLevels = MipmapGenerator::GetMipLevelCount(texture->Width, texture->Height);
+	std::vector<uint8_t> mipData;
+	texture->Levels = MipmapGenerator::GenerateLevels(texture->Data.data(), texture->Width, texture->Height, mipLevels, mipData);
+	texture->Data = std::move(mipData);
+	return texture;
+}
+
+void TextureStreamer::CreateImage(StreamedTexture& texture)
+{
+	const TextureData& data = *texture.Data;
+
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = data.Width;
+	imageInfo.extent.height = data.Height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = static_cast<uint32_t>(data.Levels.size());
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = data.Format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(Device, &imageInfo, nullptr, &texture.Image) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create streamed texture image!");
+	}
+
+	texture.ImageMemory = Allocator->AllocateImageMemory(texture.Image, VK_IMAGE_TILING_OPTIMAL, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	texture.LevelCount = imageInfo.mipLevels;
+	texture.ResidentLevel = texture.LevelCount;
+	texture.UploadingLevel = texture.LevelCount;
+}
+
+VkDeviceSize TextureStreamer::RecordUpload(StreamedTexture& texture, uint32_t firstLevel)
+{
+	PROFILE_FUNCTION();
+	const TextureData& data = *texture.Data;
+	uint32_t levelCount = texture.UploadingLevel - firstLevel;
+
+	VkDeviceSize size = 0;
+	for (uint32_t i = firstLevel; i < texture.UploadingLevel; i++)
+	{
+		size += (data.Levels[i].Size + StagingLevelAlignment - 1) / StagingLevelAlignment * StagingLevelAlignment;
+	}
+
+	StagingAllocation staging = Staging->Allocate(size);
+	VkCommandBuffer commandBuffer = Uploads->GetCommandBuffer();
+
+	VkImageSubresourceRange subresourceRange = {};
+	subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	subresourceRange.baseMipLevel = firstLevel;
+	subresourceRange.levelCount = levelCount;
+	subresourceRange.baseArrayLayer = 0;
+	subresourceRange.layerCount = 1;
+
+	//Only the new levels are touched; the resident ones stay in SHADER_READ_ONLY and keep being sampled.
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = texture.Image;
+	barrier.subresourceRange = subresourceRange;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	std::vector<VkBufferImageCopy> regions;
+	VkDeviceSize offset = 0;
+	for (uint32_t i = firstLevel; i < texture.UploadingLevel; i++)
+	{
+		const MipLevel& level = data.Levels[i];
+		memcpy(static_cast<uint8_t*>(staging.MappedData) + offset, data.Data.data() + level.Offset, static_cast<size_t>(level.Size));
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = staging.Offset + offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = i;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { level.Width, level.Height, 1 };
+		regions.push_back(region);
+
+		offset += (level.Size + StagingLevelAlignment - 1) / StagingLevelAlignment * StagingLevelAlignment;
+	}
+
+	vkCmdCopyBufferToImage(commandBuffer, staging.Buffer, texture.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+	Uploads->TransferImageOwnership(texture.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, subresourceRange, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+	texture.UploadingLevel = firstLevel;
+	BytesUploaded += size;
+	return size;
+}
+
+void TextureStreamer::MakeResident(TextureHandle handle, uint32_t firstLevel)
+{
+	if (handle >= Textures.size())
+	{
+		return;
+	}
+
+	StreamedTexture& texture = Textures[handle];
+
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = texture.Image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = texture.Data->Format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = firstLevel;
+	viewInfo.subresourceRange.levelCount = texture.LevelCount - firstLevel;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	VkImageView view;
+	if (vkCreateImageView(Device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create streamed texture view!");
+	}
+
+	RetireView(texture, false);
+	texture.View = view;
+	texture.Slot = Bindless->Add(view, Sampler);
+	texture.ResidentLevel = firstLevel;
+
+	if (firstLevel == 0)
+	{
+		texture.Data.reset();
+	}
+}
+
+void TextureStreamer::RetireView(StreamedTexture& texture, bool destroyImage)
+{
+	if (texture.View == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//Frames up to and including the one being prepared may still sample the old slot.
+	RetiredView retired = {};
+	retired.View = texture.View;
+	retired.LastFrame = CurrentFrame;
+	if (destroyImage)
+	{
+		retired.Image = texture.Image;
+		retired.ImageMemory = texture.ImageMemory;
+		texture.Image = VK_NULL_HANDLE;
+	}
+	RetiredViews.push_back(retired);
+
+	Bindless->Remove(texture.Slot, CurrentFrame);
+	texture.View = VK_NULL_HANDLE;
+}
+
+uint32_t TextureStreamer::GetTargetLevel(const StreamedTexture& texture) const
+{
+	//The finest level whose size still does not exceed what the screen can show, in whole levels.
+	uint32_t size = std::max(texture.Data->Width, texture.Data->Height);
+	float ratio = static_cast<float>(size) / std::max(texture.ScreenSize, 1.0f);
+	uint32_t level = ratio > 1.0f ? static_cast<uint32_t>(std::floor(std::log2(ratio))) : 0;
+	return std::min(level, texture.LevelCount - 1);
+}
+
+uint32_t TextureStreamer::GetNextLevel(const StreamedTexture& texture) const
+{
+	if (texture.UploadingLevel == texture.LevelCount)
+	{
+		uint32_t tailLevel = 0;
+		while (tailLevel + 1 < texture.LevelCount &&
+			std::max(texture.Data->Levels[tailLevel].Width, texture.Data->Levels[tailLevel].Height) > MipTailSize)
+		{
+			tailLevel++;
+		}
+		return std::max(tailLevel, GetTargetLevel(texture));
+	}
+
+	if (texture.UploadingLevel > GetTargetLevel(texture))
+	{
+		return texture.UploadingLevel - 1;
+	}
+	return texture.UploadingLevel;
+}
+
+void TextureStreamer::Update(uint64_t currentFrame, uint64_t completedFrameCount)
+{
+	PROFILE_FUNCTION();
+	CurrentFrame = currentFrame;
+
+	auto completed = std::stable_partition(RetiredViews.begin(), RetiredViews.end(),
+		[completedFrameCount](const RetiredView& retired) { return retired.LastFrame > completedFrameCount; });
+	for (auto it = completed; it != RetiredViews.end(); ++it)
+	{
+		vkDestroyImageView(Device, it->View, nullptr);
+		if (it->Image != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(Device, it->Image, nullptr);
+			Allocator->Free(it->ImageMemory);
+		}
+	}
+	RetiredViews.erase(completed, RetiredViews.end());
+
+	std::vector<DecodeResult> results;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		results.swap(DecodeResults);
+	}
+
+	for (auto& result : results)
+	{
+		StreamedTexture& texture = Textures[result.Handle];
+		if (!result.Data)
+		{
+			std::cerr << "texture streaming: " << result.Error << std::endl;
+			texture.Failed = true;
+			continue;
+		}
+
+		texture.Data = result.Data;
+		CreateImage(texture);
+	}
+
+	//Spend the budget on the largest textures on screen first. One step always goes through so a single level bigger
+	//than the budget still makes progress.
+	VkDeviceSize budgetLeft = UploadBudget;
+	bool recorded = false;
+	while (true)
+	{
+		TextureHandle best = static_cast<TextureHandle>(Textures.size());
+		for (TextureHandle handle = 0; handle < Textures.size(); handle++)
+		{
+			const StreamedTexture& texture = Textures[handle];
+			if (!texture.Data || texture.Image == VK_NULL_HANDLE || GetNextLevel(texture) >= texture.UploadingLevel)
+			{
+				continue;
+			}
+			if (best == Textures.size() || texture.ScreenSize > Textures[best].ScreenSize)
+			{
+				best = handle;
+			}
+		}
+		if (best == Textures.size())
+		{
+			break;
+		}
+
+		StreamedTexture& texture = Textures[best];
+		uint32_t firstLevel = GetNextLevel(texture);
+
+		VkDeviceSize cost = 0;
+		for (uint32_t i = firstLevel; i < texture.UploadingLevel; i++)
+		{
+			cost += texture.Data->Levels[i].Size;
+		}
+		if (recorded && cost > budgetLeft)
+		{
+			break;
+		}
+
+		RecordUpload(texture, firstLevel);
+		Uploads->OnComplete([this, best, firstLevel]() { MakeResident(best, firstLevel); });
+		budgetLeft -= std::min(cost, budgetLeft);
+		recorded = true;
+	}
+
+	if (recorded)
+	{
+		Uploads->Submit();
+	}
+}
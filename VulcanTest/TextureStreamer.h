@@ -0,0 +1,143 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "MemoryAllocator.h"
+#include "UploadContext.h"
+#include "StagingBufferPool.h"
+#include "BindlessTextures.h"
+#include "TextureLoader.h"
+#include "AssetReader.h"
+
+typedef uint32_t TextureHandle;
+
+//Loads textures in the background and makes them resident a few mip levels at a time.
+//Worker threads read and decode files (stb_image with CPU mips, or KTX2/DDS through TextureLoader); Update() on the render
+//thread uploads decoded levels within a per-frame byte budget, mip tail first and then one larger level per step, picking
+//the texture with the largest screen-space size first. Until a texture has any level resident its slot is a 1x1 placeholder.
+//Every residency change gets a fresh view and bindless slot, as slots may not be rewritten while frames still sample them.
+//Shaders reach a texture through its handle: a slot table buffer maps every handle to its current slot, so a residency change
+//rewrites one table entry however many instances use the texture.
+class TextureStreamer
+{
+private:
+	struct DecodeJob
+	{
+		TextureHandle Handle;
+		std::string Path;
+		float ScreenSize;
+	};
+
+	struct DecodeResult
+	{
+		TextureHandle Handle;
+		std::shared_ptr<TextureData> Data;
+		std::string Error;
+	};
+
+	struct StreamedTexture
+	{
+		std::string Path;
+		float ScreenSize = 0.0f;
+		bool Failed = false;
+		//Decoded levels, kept until level 0 is resident.
+		std::shared_ptr<TextureData> Data;
+
+		VkImage Image = VK_NULL_HANDLE;
+		MemoryAllocation ImageMemory;
+		uint32_t LevelCount = 0;
+		//Lowest mip level that can be sampled; LevelCount while nothing is resident.
+		uint32_t ResidentLevel = 0;
+		//Lowest level recorded into an upload that has not completed yet.
+		uint32_t UploadingLevel = 0;
+		VkImageView View = VK_NULL_HANDLE;
+		uint32_t Slot = 0;
+	};
+
+	struct RetiredView
+	{
+		VkImageView View;
+		VkImage Image;
+		MemoryAllocation ImageMemory;
+		uint64_t LastFrame;
+	};
+
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkDevice Device = VK_NULL_HANDLE;
+	MemoryAllocator* Allocator = nullptr;
+	StagingBufferPool* Staging = nullptr;
+	UploadContext* Uploads = nullptr;
+	BindlessTextures* Bindless = nullptr;
+	const AssetReader* Assets = nullptr;
+	VkSampler Sampler = VK_NULL_HANDLE;
+	VkDeviceSize UploadBudget = 0;
+
+	VkBuffer SlotTableBuffer = VK_NULL_HANDLE;
+	MemoryAllocation SlotTableMemory;
+	uint32_t MaxTextures = 0;
+	//Slot last written to each handle's table entry; UINT32_MAX until the first write.
+	std::vector<uint32_t> TableSlots;
+
+	StreamedTexture Placeholder;
+	std::vector<StreamedTexture> Textures;
+	std::vector<RetiredView> RetiredViews;
+	uint64_t CurrentFrame = 0;
+	VkDeviceSize BytesUploaded = 0;
+
+	//Workers only ever see the queues below, never Textures.
+	std::mutex Mutex;
+	std::condition_variable WorkAvailable;
+	std::vector<DecodeJob> DecodeQueue;
+	std::vector<DecodeResult> DecodeResults;
+	std::vector<std::thread> Workers;
+	bool Stopping = false;
+
+	void WorkerLoop();
+	std::shared_ptr<TextureData> Decode(const std::string& path);
+
+	void CreateImage(StreamedTexture& texture);
+	VkDeviceSize RecordUpload(StreamedTexture& texture, uint32_t firstLevel);
+	void MakeResident(TextureHandle handle, uint32_t firstLevel);
+	void RetireView(StreamedTexture& texture, bool destroyImage);
+	uint32_t GetTargetLevel(const StreamedTexture& texture) const;
+	uint32_t GetNextLevel(const StreamedTexture& texture) const;
+
+public:
+	//Levels no larger than this are uploaded together as the first step.
+	static constexpr uint32_t MipTailSize = 64;
+
+	TextureStreamer();
+	~TextureStreamer();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, StagingBufferPool& staging, UploadContext& uploads,
+		BindlessTextures& bindless, const AssetReader& assets, VkSampler sampler, uint32_t threadCount, VkDeviceSize uploadBudgetPerFrame);
+	//Expects the device to be idle.
+	void Destroy();
+
+	//Queues the asset for decoding; a baked .ktx2 next to an image file is used in its place. Never blocks on I/O.
+	TextureHandle Request(const std::string& path);
+	//Projected size of the largest use of the texture, in pixels; bigger textures stream first and only the levels the
+	//size calls for are uploaded.
+	void SetScreenSize(TextureHandle handle, float pixels);
+
+	//Call once per frame before recording. currentFrame is the index the next submission will get, completedFrameCount
+	//the number of submissions known to be finished; old views are freed against it. Submits its uploads itself.
+	void Update(uint64_t currentFrame, uint64_t completedFrameCount);
+
+	//Slot to sample with this frame: the placeholder until the first levels arrive.
+	uint32_t GetSlot(TextureHandle handle) const;
+	//Records a vkCmdUpdateBuffer for every table entry whose slot changed since the last call, between barriers against the
+	//readStages that read the table. Must be recorded outside a render pass. Returns false when nothing changed.
+	bool RecordSlotTableUpdate(VkCommandBuffer commandBuffer, VkPipelineStageFlags readStages);
+	//One uint32_t bindless slot per TextureHandle, with STORAGE_BUFFER usage.
+	VkBuffer GetSlotTableBuffer() const { return SlotTableBuffer; }
+	uint32_t GetResidentLevel(TextureHandle handle) const { return Textures[handle].ResidentLevel; }
+	bool IsFullyResident(TextureHandle handle) const { return Textures[handle].LevelCount > 0 && Textures[handle].ResidentLevel == 0; }
+	//True once every texture has failed or has the levels its screen size calls for resident, with nothing in flight.
+	bool IsIdle() const;
+	VkDeviceSize GetBytesUploaded() const { return BytesUploaded; }
+};
@@ -0,0 +1,49 @@
+#include "UniformRingBuffer.h"
+#include "BufferManager.h"
+#include <stdexcept>
+
+UniformRingBuffer::UniformRingBuffer()
+{
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+}
+
+void UniformRingBuffer::Create(MemoryAllocator& allocator, VkDevice device, VkDeviceSize minUniformBufferOffsetAlignment, VkDeviceSize frameCapacity, uint32_t frameCount)
+{
+	Alignment = minUniformBufferOffsetAlignment > 0 ? minUniformBufferOffsetAlignment : 1;
+	FrameSize = GetAlignedSize(frameCapacity);
+	FrameCount = frameCount;
+	CurrentFrame = 0;
+	FrameCursor = 0;
+
+	BufferManager::CreateBuffer(allocator, device, FrameSize * FrameCount, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, Buffer, BufferMemory);
+}
+
+void UniformRingBuffer::Destroy(MemoryAllocator& allocator, VkDevice device)
+{
+	vkDestroyBuffer(device, Buffer, nullptr);
+	allocator.Free(BufferMemory);
+	Buffer = VK_NULL_HANDLE;
+}
+
+void UniformRingBuffer::BeginFrame(uint32_t frame)
+{
+	CurrentFrame = frame % FrameCount;
+	FrameCursor = 0;
+}
+
+void* UniformRingBuffer::Allocate(VkDeviceSize size, uint32_t& dynamicOffset)
+{
+	VkDeviceSize alignedSize = GetAlignedSize(size);
+	if (FrameCursor + alignedSize > FrameSize) {
+		throw std::runtime_error("uniform ring buffer frame capacity exceeded!");
+	}
+
+	VkDeviceSize offset = CurrentFrame * FrameSize + FrameCursor;
+	FrameCursor += alignedSize;
+
+	dynamicOffset = static_cast<uint32_t>(offset);
+	return static_cast<char*>(BufferMemory.MappedData) + offset;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include "MemoryAllocator.h"
+
+//One persistently mapped, host coherent uniform buffer split into a region per frame.
+//Uniform data is written with a pointer bump and bound through a UNIFORM_BUFFER_DYNAMIC offset,
+//so there is no vkMapMemory/vkUnmapMemory on the hot path and no VkBuffer per object.
+class UniformRingBuffer
+{
+private:
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	MemoryAllocation BufferMemory;
+	VkDeviceSize Alignment = 0;
+	VkDeviceSize FrameSize = 0;
+	uint32_t FrameCount = 0;
+	uint32_t CurrentFrame = 0;
+	VkDeviceSize FrameCursor = 0;
+
+public:
+	UniformRingBuffer();
+	~UniformRingBuffer();
+
+	void Create(MemoryAllocator& allocator, VkDevice device, VkDeviceSize minUniformBufferOffsetAlignment, VkDeviceSize frameCapacity, uint32_t frameCount);
+	void Destroy(MemoryAllocator& allocator, VkDevice device);
+
+	void BeginFrame(uint32_t frame);
+	void* Allocate(VkDeviceSize size, uint32_t& dynamicOffset);
+
+	template<class T> uint32_t Push(const T& data)
+	{
+		uint32_t dynamicOffset;
+		*static_cast<T*>(Allocate(sizeof(T), dynamicOffset)) = data;
+		return dynamicOffset;
+	}
+
+	VkBuffer GetBuffer() { return Buffer; }
+	uint32_t GetFrameOffset(uint32_t frame) { return static_cast<uint32_t>(frame * FrameSize); }
+	VkDeviceSize GetAlignedSize(VkDeviceSize size) { return (size + Alignment - 1) & ~(Alignment - 1); }
+};
@@ -0,0 +1,374 @@
+#include "UploadContext.h"
+#include "Profiler.h"
+#include <stdexcept>
+
+UploadContext::UploadContext()
+{
+}
+
+UploadContext::~UploadContext()
+{
+}
+
+void UploadContext::Initialize(VkDevice device, VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily)
+{
+	Device = device;
+	TransferQueue = transferQueue;
+	TransferFamily = transferFamily;
+	GraphicsQueue = graphicsQueue;
+	GraphicsFamily = graphicsFamily;
+
+	TransferCommandPool = CreateCommandPool(TransferFamily);
+	if (HasDedicatedTransferQueue())
+	{
+		GraphicsCommandPool = CreateCommandPool(GraphicsFamily);
+	}
+}
+
+void UploadContext::Destroy()
+{
+	if (Recording) {
+		Submit();
+	}
+	WaitIdle();
+
+	for (auto& batch : FreeBatches)
+	{
+		vkDestroyFence(Device, batch.Fence, nullptr);
+		if (batch.TransferSemaphore != VK_NULL_HANDLE)
+		{
+			vkDestroySemaphore(Device, batch.TransferSemaphore, nullptr);
+		}
+	}
+	FreeBatches.clear();
+
+	vkDestroyCommandPool(Device, TransferCommandPool, nullptr);
+	if (GraphicsCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(Device, GraphicsCommandPool, nullptr);
+	}
+}
+
+VkCommandPool UploadContext::CreateCommandPool(uint32_t queueFamilyIndex)
+{
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(Device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create upload command pool!");
+	}
+
+	return commandPool;
+}
+
+VkCommandBuffer UploadContext::AllocateCommandBuffer(VkCommandPool commandPool)
+{
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(Device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate upload command buffer!");
+	}
+
+	return commandBuffer;
+}
+
+VkCommandBuffer UploadContext::GetCommandBuffer()
+{
+	if (Recording)
+	{
+		return RecordingBatch.CommandBuffer;
+	}
+
+	if (!FreeBatches.empty())
+	{
+		RecordingBatch = FreeBatches.back();
+		FreeBatches.pop_back();
+
+		vkResetCommandBuffer(RecordingBatch.CommandBuffer, 0);
+		if (RecordingBatch.AcquireCommandBuffer != VK_NULL_HANDLE)
+		{
+			vkResetCommandBuffer(RecordingBatch.AcquireCommandBuffer, 0);
+		}
+		vkResetFences(Device, 1, &RecordingBatch.Fence);
+	}
+	else
+	{
+		RecordingBatch = UploadBatch();
+		RecordingBatch.CommandBuffer = AllocateCommandBuffer(TransferCommandPool);
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(Device, &fenceInfo, nullptr, &RecordingBatch.Fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload fence!");
+		}
+
+		if (HasDedicatedTransferQueue())
+		{
+			RecordingBatch.AcquireCommandBuffer = AllocateCommandBuffer(GraphicsCommandPool);
+
+			VkSemaphoreCreateInfo semaphoreInfo = {};
+			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+			if (vkCreateSemaphore(Device, &semaphoreInfo, nullptr, &RecordingBatch.TransferSemaphore) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create upload semaphore!");
+			}
+		}
+	}
+
+	RecordingBatch.Token = NextToken++;
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(RecordingBatch.CommandBuffer, &beginInfo);
+	Recording = true;
+
+	return RecordingBatch.CommandBuffer;
+}
+
+UploadToken UploadContext::GetRecordingToken()
+{
+	GetCommandBuffer();
+	return RecordingBatch.Token;
+}
+
+void UploadContext::TransferBufferOwnership(VkBuffer buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+{
+	VkCommandBuffer commandBuffer = GetCommandBuffer();
+
+	//On a shared queue family the memory barrier recorded by Submit() already covers the buffer.
+	if (!HasDedicatedTransferQueue())
+	{
+		return;
+	}
+
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = TransferFamily;
+	barrier.dstQueueFamilyIndex = GraphicsFamily;
+	barrier.buffer = buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0,
+		0, nullptr,
+		1, &barrier,
+		0, nullptr
+	);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccessMask;
+	RecordingBatch.BufferAcquires.push_back(barrier);
+	RecordingBatch.AcquireStageMask |= dstStageMask;
+}
+
+void UploadContext::TransferImageOwnership(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, const VkImageSubresourceRange& subresourceRange, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask)
+{
+	VkCommandBuffer commandBuffer = GetCommandBuffer();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.image = image;
+	barrier.subresourceRange = subresourceRange;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	//Without a dedicated transfer queue this is a plain layout transition on the graphics queue.
+	if (!HasDedicatedTransferQueue())
+	{
+		barrier.dstAccessMask = dstAccessMask;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, dstStageMask,
+			0,
+			0, nullptr,
+			0, nullptr,
+			1, &barrier
+		);
+		return;
+	}
+
+	barrier.dstAccessMask = 0;
+	barrier.srcQueueFamilyIndex = TransferFamily;
+	barrier.dstQueueFamilyIndex = GraphicsFamily;
+
+	vkCmdPipelineBarrier(
+		commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+		0,
+		0, nullptr,
+		0, nullptr,
+		1, &barrier
+	);
+
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = dstAccessMask;
+	RecordingBatch.ImageAcquires.push_back(barrier);
+	RecordingBatch.AcquireStageMask |= dstStageMask;
+}
+
+void UploadContext::OnComplete(std::function<void()> callback)
+{
+	GetCommandBuffer();
+	RecordingBatch.CompletionCallbacks.push_back(callback);
+}
+
+UploadToken UploadContext::Submit()
+{
+	if (!Recording)
+	{
+		return NextToken - 1;
+	}
+	PROFILE_FUNCTION();
+
+	if (!HasDedicatedTransferQueue())
+	{
+		//Make every transfer write in the batch visible to later vertex, index, compute and shader reads on this queue.
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+		vkCmdPipelineBarrier(
+			RecordingBatch.CommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1, &barrier,
+			0, nullptr,
+			0, nullptr
+		);
+	}
+
+	vkEndCommandBuffer(RecordingBatch.CommandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &RecordingBatch.CommandBuffer;
+
+	if (!HasDedicatedTransferQueue())
+	{
+		if (vkQueueSubmit(GraphicsQueue, 1, &submitInfo, RecordingBatch.Fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit upload command buffer!");
+		}
+	}
+	else
+	{
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &RecordingBatch.TransferSemaphore;
+
+		if (vkQueueSubmit(TransferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit upload command buffer!");
+		}
+
+		//The acquire half of each ownership transfer runs on the graphics queue once the copies have finished.
+		VkPipelineStageFlags waitStageMask = RecordingBatch.AcquireStageMask != 0 ? RecordingBatch.AcquireStageMask : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(RecordingBatch.AcquireCommandBuffer, &beginInfo);
+		if (!RecordingBatch.BufferAcquires.empty() || !RecordingBatch.ImageAcquires.empty())
+		{
+			vkCmdPipelineBarrier(
+				RecordingBatch.AcquireCommandBuffer,
+				waitStageMask, waitStageMask,
+				0,
+				0, nullptr,
+				static_cast<uint32_t>(RecordingBatch.BufferAcquires.size()), RecordingBatch.BufferAcquires.data(),
+				static_cast<uint32_t>(RecordingBatch.ImageAcquires.size()), RecordingBatch.ImageAcquires.data()
+			);
+		}
+		vkEndCommandBuffer(RecordingBatch.AcquireCommandBuffer);
+
+		VkSubmitInfo acquireInfo = {};
+		acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireInfo.waitSemaphoreCount = 1;
+		acquireInfo.pWaitSemaphores = &RecordingBatch.TransferSemaphore;
+		acquireInfo.pWaitDstStageMask = &waitStageMask;
+		acquireInfo.commandBufferCount = 1;
+		acquireInfo.pCommandBuffers = &RecordingBatch.AcquireCommandBuffer;
+
+		if (vkQueueSubmit(GraphicsQueue, 1, &acquireInfo, RecordingBatch.Fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to submit upload acquire command buffer!");
+		}
+	}
+
+	UploadToken token = RecordingBatch.Token;
+	RecordingBatch.BufferAcquires.clear();
+	RecordingBatch.ImageAcquires.clear();
+	RecordingBatch.AcquireStageMask = 0;
+	PendingBatches.push_back(RecordingBatch);
+	RecordingBatch = UploadBatch();
+	Recording = false;
+
+	return token;
+}
+
+void UploadContext::RetireBatch(UploadBatch& batch)
+{
+	for (auto& callback : batch.CompletionCallbacks)
+	{
+		callback();
+	}
+	batch.CompletionCallbacks.clear();
+
+	CompletedToken = batch.Token;
+	FreeBatches.push_back(batch);
+}
+
+bool UploadContext::IsComplete(UploadToken token)
+{
+	Collect();
+	return token <= CompletedToken;
+}
+
+void UploadContext::Wait(UploadToken token)
+{
+	if (Recording && token >= RecordingBatch.Token)
+	{
+		Submit();
+	}
+
+	while (!PendingBatches.empty() && PendingBatches.front().Token <= token)
+	{
+		vkWaitForFences(Device, 1, &PendingBatches.front().Fence, VK_TRUE, UINT64_MAX);
+		RetireBatch(PendingBatches.front());
+		PendingBatches.pop_front();
+	}
+}
+
+void UploadContext::WaitIdle()
+{
+	PROFILE_FUNCTION();
+	Wait(NextToken - 1);
+}
+
+void UploadContext::Collect()
+{
+	while (!PendingBatches.empty() && vkGetFenceStatus(Device, PendingBatches.front().Fence) == VK_SUCCESS)
+	{
+		RetireBatch(PendingBatches.front());
+		PendingBatches.pop_front();
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <vulkan\vulkan_core.h>
+#include <deque>
+#include <vector>
+#include <functional>
+
+typedef uint64_t UploadToken;
+
+//Records copies and layout transitions from many uploads into one command buffer and submits them with a fence.
+//Submit() hands back a token that can be polled or waited on instead of stalling the queue after every copy.
+//When the device has a dedicated transfer queue family the copies run there, and resources are handed to the
+//graphics family with release/acquire barriers; otherwise everything is recorded on the graphics queue.
+class UploadContext
+{
+private:
+	struct UploadBatch
+	{
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkCommandBuffer AcquireCommandBuffer = VK_NULL_HANDLE;
+		VkSemaphore TransferSemaphore = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+		UploadToken Token = 0;
+		std::vector<VkBufferMemoryBarrier> BufferAcquires;
+		std::vector<VkImageMemoryBarrier> ImageAcquires;
+		VkPipelineStageFlags AcquireStageMask = 0;
+		std::vector<std::function<void()>> CompletionCallbacks;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkQueue TransferQueue = VK_NULL_HANDLE;
+	VkQueue GraphicsQueue = VK_NULL_HANDLE;
+	uint32_t TransferFamily = 0;
+	uint32_t GraphicsFamily = 0;
+	VkCommandPool TransferCommandPool = VK_NULL_HANDLE;
+	VkCommandPool GraphicsCommandPool = VK_NULL_HANDLE;
+
+	UploadBatch RecordingBatch;
+	bool Recording = false;
+	std::deque<UploadBatch> PendingBatches;
+	std::vector<UploadBatch> FreeBatches;
+
+	UploadToken NextToken = 1;
+	UploadToken CompletedToken = 0;
+
+	VkCommandPool CreateCommandPool(uint32_t queueFamilyIndex);
+	VkCommandBuffer AllocateCommandBuffer(VkCommandPool commandPool);
+	void RetireBatch(UploadBatch& batch);
+
+public:
+	UploadContext();
+	~UploadContext();
+
+	void Initialize(VkDevice device, VkQueue transferQueue, uint32_t transferFamily, VkQueue graphicsQueue, uint32_t graphicsFamily);
+	void Destroy();
+
+	bool HasDedicatedTransferQueue() { return TransferFamily != GraphicsFamily; }
+
+	VkCommandBuffer GetCommandBuffer();
+	UploadToken GetRecordingToken();
+	void TransferBufferOwnership(VkBuffer buffer, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+	void TransferImageOwnership(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, const VkImageSubresourceRange& subresourceRange, VkAccessFlags dstAccessMask, VkPipelineStageFlags dstStageMask);
+	void OnComplete(std::function<void()> callback);
+	UploadToken Submit();
+
+	bool IsComplete(UploadToken token);
+	void Wait(UploadToken token);
+	void WaitIdle();
+	void Collect();
+};
@@ -1 +1,71 @@
 #pragma once
+#include <vulkan\vulkan_core.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstddef>
+
+//Matches the std430 Instance struct in Cull.comp, hence the padding.
+struct InstanceData {
+	glm::mat4 model;
+	//A TextureHandle in the scene's instance buffer; the cull pass swaps it for the bindless slot in the instances it draws.
+	uint32_t textureIndex;
+	uint32_t padding[3];
+};
+
+struct Vertex {
+	glm::vec3 pos;
+	glm::vec3 color;
+	glm::vec2 texCoord;
+
+	bool operator==(const Vertex& other) const {
+		return pos == other.pos && color == other.color && texCoord == other.texCoord;
+	}
+
+	static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions() {
+		std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {};
+
+		bindingDescriptions[0].binding = 0;
+		bindingDescriptions[0].stride = sizeof(Vertex);
+		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		bindingDescriptions[1].binding = 1;
+		bindingDescriptions[1].stride = sizeof(InstanceData);
+		bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+		return bindingDescriptions;
+	}
+
+	static std::array<VkVertexInputAttributeDescription, 8> getAttributeDescriptions() {
+		std::array<VkVertexInputAttributeDescription, 8> attributeDescriptions = {};
+
+		attributeDescriptions[0].binding = 0;
+		attributeDescriptions[0].location = 0;
+		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[0].offset = offsetof(Vertex, pos);
+
+		attributeDescriptions[1].binding = 0;
+		attributeDescriptions[1].location = 1;
+		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributeDescriptions[1].offset = offsetof(Vertex, color);
+
+		attributeDescriptions[2].binding = 0;
+		attributeDescriptions[2].location = 2;
+		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
+		attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
+
+		//A mat4 attribute takes one location per column.
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions[3 + column].binding = 1;
+			attributeDescriptions[3 + column].location = 3 + column;
+			attributeDescriptions[3 + column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			attributeDescriptions[3 + column].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * column;
+		}
+
+		attributeDescriptions[7].binding = 1;
+		attributeDescriptions[7].location = 7;
+		attributeDescriptions[7].format = VK_FORMAT_R32_UINT;
+		attributeDescriptions[7].offset = offsetof(InstanceData, textureIndex);
+
+		return attributeDescriptions;
+	}
+};